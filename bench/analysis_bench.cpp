@@ -0,0 +1,141 @@
+// Times the IR analyses of cfg.h on one generated procedure. It builds the
+// IR the lowering would give a wain of random statements over the given
+// number of variables: v = v + v, and while and if on v < v, nested up to
+// depth. Each analysis is timed after the ones it depends on, best of five
+// runs.
+//
+// usage: bench/analysis_bench variables statements depth [seed]
+#include "cfg.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace {
+
+struct Generator {
+  IrProcedure ir;
+  std::mt19937 random;
+  int depth;
+
+  Generator(int variables, int depth, unsigned seed)
+      : random(seed), depth(depth) {
+    ir.params = 2;
+    ir.variables = variables;
+    ir.vregs = variables;
+    ir.inMemory.assign(variables, false);
+  }
+
+  std::int32_t variable() { return random() % ir.variables; }
+  std::int32_t emit(IrOp op, std::int32_t a = NO_VREG,
+                    std::int32_t b = NO_VREG) {
+    std::int32_t dst = ir.vregs++;
+    ir.code.push_back({op, dst, a, b, 0});
+    return dst;
+  }
+  // the block being filled
+  std::int32_t current() const { return ir.blocks.size(); }
+  // ends the current block; its successors are filled in by the caller
+  std::int32_t close(IrOp op, std::int32_t test = NO_VREG) {
+    ir.code.push_back({op, NO_VREG, test, NO_VREG, 0});
+    IrBlock block;
+    block.begin = ir.blocks.empty() ? 0 : ir.blocks.back().end;
+    block.end = ir.code.size();
+    ir.blocks.push_back(block);
+    return ir.blocks.size() - 1;
+  }
+  std::int32_t test() { return emit(IR_LT, variable(), variable()); }
+
+  void statement(int level) {
+    double r = std::uniform_real_distribution<double>(0, 1)(random);
+    if (level < depth && r < 0.3) {
+      std::int32_t entry = close(IR_JUMP);
+      std::int32_t header = current();
+      ir.blocks[entry].successors[0] = header;
+      std::int32_t branch = close(IR_BRANCH, test());
+      ir.blocks[branch].successors[0] = current();
+      std::int32_t counter = variable();
+      ir.code.push_back({IR_ADD, counter, counter, emit(IR_CONST), 0});
+      statement(level + 1);
+      std::int32_t latch = close(IR_JUMP);
+      ir.blocks[latch].successors[0] = header;
+      ir.blocks[branch].successors[1] = current();
+    } else if (level < depth && r < 0.6) {
+      std::int32_t branch = close(IR_BRANCH, test());
+      ir.blocks[branch].successors[0] = current();
+      statement(level + 1);
+      std::int32_t thenEnd = close(IR_JUMP);
+      ir.blocks[branch].successors[1] = current();
+      statement(level + 1);
+      std::int32_t elseEnd = close(IR_JUMP);
+      ir.blocks[thenEnd].successors[0] = current();
+      ir.blocks[elseEnd].successors[0] = current();
+    } else {
+      ir.code.push_back({IR_ADD, variable(), variable(), variable(), 0});
+    }
+  }
+};
+
+template <typename F> double bestOfFive(IrProcedure &ir, F analyses) {
+  double best = 1e30;
+  for (int run = 0; run < 5; ++run) {
+    invalidateAnalyses(ir);
+    best = std::min(best, analyses());
+  }
+  return best;
+}
+
+template <typename F> double millisecondsOf(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 4 || argc > 5) {
+    std::cerr << "usage: " << argv[0]
+              << " variables statements depth [seed]\n";
+    return 1;
+  }
+  int variables = std::atoi(argv[1]);
+  int statements = std::atoi(argv[2]);
+  int depth = std::atoi(argv[3]);
+  unsigned seed = argc > 4 ? std::atoi(argv[4]) : 1;
+  if (variables < 2 || statements < 0 || depth < 0) {
+    std::cerr << "need 2 or more variables and no negative counts\n";
+    return 1;
+  }
+  Generator generator(variables, depth, seed);
+  for (int i = 0; i < statements; ++i) {
+    generator.statement(0);
+  }
+  generator.close(IR_RET, 0);
+  IrProcedure &ir = generator.ir;
+
+  double cfg = bestOfFive(ir, [&] {
+    return millisecondsOf([&] { controlFlow(ir); });
+  });
+  double dom = bestOfFive(ir, [&] {
+    controlFlow(ir);
+    return millisecondsOf([&] { dominators(ir); });
+  });
+  double live = bestOfFive(ir, [&] {
+    controlFlow(ir);
+    return millisecondsOf([&] { liveness(ir); });
+  });
+  double nest = bestOfFive(ir, [&] {
+    dominators(ir);
+    return millisecondsOf([&] { loops(ir); });
+  });
+  std::printf("%zu blocks, %zu instructions, %d variables\n",
+              ir.blocks.size(), ir.code.size(), ir.variables);
+  std::printf("cfg %.1f ms, dominators %.1f ms, liveness %.1f ms, "
+              "loops %.1f ms\n", cfg, dom, live, nest);
+  return 0;
+}
@@ -0,0 +1,23 @@
+#!/usr/bin/env python3
+# Generates a comment-heavy WLP4 program: 300 procedures, each after a
+# 40-line comment header and with 60 statements indented by 24 spaces and
+# followed by a trailing comment. Most of its bytes are whitespace and
+# comment bodies.
+#
+# usage: gen_comments.py > comments.wlp4
+import random
+
+random.seed(2)
+WORDS = ['generated', 'by', 'the', 'tool', 'version', 'licence', 'copyright',
+         'header', 'field', 'value']
+out = []
+for p in range(300):
+    for c in range(40):
+        out.append('// ' + ' '.join(random.choice(WORDS) for _ in range(12)))
+    out.append('int f%d(int a, int b) {' % p)
+    for s in range(60):
+        out.append(' ' * 24 + 'a = a + b;' + ' ' * 8 +
+                   '// keep a running total of b in a')
+    out.append('    return a;\n}')
+out.append('int wain(int a, int b) { return a; }')
+print('\n'.join(out))
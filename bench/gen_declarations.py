@@ -0,0 +1,16 @@
+#!/usr/bin/env python3
+# Generates a program with a procedure of n parameters and n locals and a
+# wain with n locals, for timing how declarations are collected.
+#
+# usage: gen_declarations.py n > program.wlp4
+import sys
+
+n = int(sys.argv[1])
+print('int f(' + ', '.join('int p%d' % i for i in range(n)) + ') {')
+for i in range(n):
+    print('  int l%d = %d;' % (i, i))
+print('  return p0 + l0;\n}')
+print('int wain(int a, int b) {')
+for i in range(n):
+    print('  int x%d = %d;' % (i, i))
+print('  return a;\n}')
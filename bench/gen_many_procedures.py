@@ -0,0 +1,24 @@
+#!/usr/bin/env python3
+# Generates a program of n procedures (default 400), each 160 statements of
+# arithmetic, if, while and new/delete, calling the previous one, for timing
+# the code generator's worker threads.
+#
+# usage: gen_many_procedures.py [n] > program.wlp4
+import random, sys
+
+R = random.Random(7)
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 400
+out = []
+for k in range(n):
+    body = ['int x = %d; int* p = NULL;' % k]
+    for j in range(40):
+        body.append('x = x + (x * %d) / 3 - %d;' % (j + 1, j))
+        body.append('if (x < %d) { println(x); } else { x = x - 1; }' % (j * 7))
+        body.append('while (x > %d) { x = x - %d; }' % (1000, 17))
+        body.append('p = new int[x + 1]; if (p != NULL) { *p = x; '
+                    'x = *p + 1; delete [] p; } else {}')
+    call = 'f%d(x, %d)' % (k - 1, k) if k else 'x'
+    body.append('return %s + a - b;' % call)
+    out.append('int f%d(int a, int b) { %s }' % (k, '\n'.join(body)))
+out.append('int wain(int a, int b) { return f%d(a, b); }' % (n - 1))
+print('\n'.join(out))
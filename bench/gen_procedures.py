@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+# Generates a WLP4 program of nprocs procedures with stmts statements each
+# (arithmetic, if, while and pointer statements in turn) and comment lines
+# of padding before each procedure. Every procedure calls the previous one.
+#
+# usage: gen_procedures.py nprocs stmts [comment_lines] > program.wlp4
+import random, sys
+
+random.seed(1)
+nprocs, stmts = int(sys.argv[1]), int(sys.argv[2])
+comments = int(sys.argv[3]) if len(sys.argv) > 3 else 2
+out = []
+for p in range(nprocs):
+    for c in range(comments):
+        out.append('// procedure %d: generated comment header line %d with '
+                   'some padding text' % (p, c))
+    out.append('int f%d(int a, int b) {' % p)
+    out.append('    int x = 0;\n    int y = 1;\n    int* q = NULL;')
+    for s in range(stmts):
+        k = s % 4
+        if k == 0:
+            out.append('        x = x + a * %d - (b / 3) %% 7;' % (s % 97 + 1))
+        elif k == 1:
+            out.append('        if (x < y) { y = y + 1; } else { x = x - 1; }')
+        elif k == 2:
+            out.append('        while (y > 100) { y = y - 50; } // loop')
+        else:
+            out.append('        q = &x; *q = *q + y;')
+    if p > 0:
+        out.append('    x = x + f%d(a, b);' % (p - 1))
+    out.append('    return x + y;\n}')
+if nprocs:
+    out.append('int wain(int a, int b) {\n    return f%d(a, b);\n}' % (nprocs - 1))
+else:
+    out.append('int wain(int a, int b) { return a; }')
+print('\n'.join(out))
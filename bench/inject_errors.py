@@ -0,0 +1,17 @@
+#!/usr/bin/env python3
+# Writes copies of a WLP4 source with one to three scan errors inserted at
+# random offsets: invalid bytes or out-of-range numbers. scan_bench checks
+# that every thread count reports the same first error as the sequential
+# scan.
+#
+# usage: inject_errors.py source.wlp4 count prefix   (writes prefix0.wlp4 ..)
+import random, sys
+
+source = open(sys.argv[1], 'rb').read()
+random.seed(1)
+for i in range(int(sys.argv[2])):
+    text = bytearray(source)
+    for _ in range(random.randint(1, 3)):
+        at = random.randrange(len(text))
+        text[at:at] = random.choice([b'$', b'99999999999', b'@', b'!x'])
+    open('%s%d.wlp4' % (sys.argv[3], i), 'wb').write(text)
@@ -0,0 +1,86 @@
+// Scanner throughput: maps a source file and tokenizes it with each given
+// thread count (default 1), reporting the best of five runs. Each result is
+// compared with a sequential scan: status, diagnostics, tokens (kind, id
+// and lexeme span) and intern table must all match.
+//
+// usage: bench/scan_bench file [threads ...]
+#include "scanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+struct ScanResult {
+  int status = 0;
+  std::string diagnostics;
+  std::vector<Token> tokens;
+  InternTable names;
+};
+
+ScanResult scanWith(std::string_view source, unsigned threads) {
+  ScanResult result;
+  std::ostringstream diagnostics;
+  result.status =
+      scan(source, result.tokens, result.names, diagnostics, threads);
+  result.diagnostics = diagnostics.str();
+  return result;
+}
+
+bool sameScan(const ScanResult &a, const ScanResult &b) {
+  if (a.status != b.status || a.diagnostics != b.diagnostics ||
+      a.names.names != b.names.names || a.tokens.size() != b.tokens.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.tokens.size(); ++i) {
+    const Token &x = a.tokens[i];
+    const Token &y = b.tokens[i];
+    if (x.kind != y.kind || x.id != y.id ||
+        x.value.data() != y.value.data() || x.value.size() != y.value.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " file [threads ...]\n";
+    return 1;
+  }
+  std::vector<unsigned> threadCounts;
+  for (int i = 2; i < argc; ++i) {
+    threadCounts.push_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (threadCounts.empty()) {
+    threadCounts.push_back(1);
+  }
+
+  SourceBuffer source = SourceBuffer::mapFile(argv[1]);
+  std::size_t bytes = source.text().size();
+  ScanResult sequential = scanWith(source.text(), 1);
+  std::printf("%zu bytes, %zu tokens\n%s", bytes, sequential.tokens.size(),
+              sequential.diagnostics.c_str());
+  bool allSame = true;
+  for (unsigned threads : threadCounts) {
+    double best = 1e30;
+    bool same = true;
+    for (int run = 0; run < 5; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      ScanResult result = scanWith(source.text(), threads);
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count());
+      same = same && sameScan(sequential, result);
+    }
+    allSame = allSame && same;
+    std::printf("threads %2u: %.1f ms, %.0f MB/s%s\n", threads, best,
+                bytes / best / 1e3, same ? "" : ", DIFFERENT");
+  }
+  return allSame ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+#include "cfg.h"
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+struct IrAnalyses {
+  std::optional<ControlFlowGraph> cfg;
+  std::optional<DominatorTree> dominators;
+  std::optional<Liveness> liveness;
+  std::optional<LoopNest> loops;
+};
+
+namespace {
+
+IrAnalyses &analysesOf(const IrProcedure &ir) {
+  if (!ir.analyses) {
+    ir.analyses = std::make_shared<IrAnalyses>();
+  }
+  return *ir.analyses;
+}
+
+ControlFlowGraph buildControlFlowGraph(const IrProcedure &ir) {
+  int blocks = ir.blocks.size();
+  ControlFlowGraph cfg;
+
+  // predecessor lists, counted first and then filled in place
+  cfg.predecessorBegin.assign(blocks + 1, 0);
+  for (const IrBlock &block : ir.blocks) {
+    for (std::int32_t s : block.successors) {
+      if (s >= 0) {
+        ++cfg.predecessorBegin[s + 1];
+      }
+    }
+  }
+  for (int b = 0; b < blocks; ++b) {
+    cfg.predecessorBegin[b + 1] += cfg.predecessorBegin[b];
+  }
+  cfg.predecessors.resize(cfg.predecessorBegin[blocks]);
+  std::vector<std::uint32_t> fill(cfg.predecessorBegin.begin(),
+                                  cfg.predecessorBegin.end() - 1);
+  for (int b = 0; b < blocks; ++b) {
+    for (std::int32_t s : ir.blocks[b].successors) {
+      if (s >= 0) {
+        cfg.predecessors[fill[s]++] = b;
+      }
+    }
+  }
+
+  // depth-first walk from the entry with an explicit stack of (block, next
+  // successor to visit); a block is numbered when it is left
+  cfg.postorderNumber.assign(blocks, -1);
+  std::vector<bool> visited(blocks, false);
+  std::vector<std::pair<std::int32_t, int>> stack;
+  std::vector<std::int32_t> postorder;
+  if (blocks > 0) {
+    stack.push_back({0, 0});
+    visited[0] = true;
+  }
+  while (!stack.empty()) {
+    auto &[block, next] = stack.back();
+    if (next < 2) {
+      std::int32_t s = ir.blocks[block].successors[next++];
+      if (s >= 0 && !visited[s]) {
+        visited[s] = true;
+        stack.push_back({s, 0});
+      }
+      continue;
+    }
+    cfg.postorderNumber[block] = postorder.size();
+    postorder.push_back(block);
+    stack.pop_back();
+  }
+  cfg.reversePostorder.assign(postorder.rbegin(), postorder.rend());
+  return cfg;
+}
+
+DominatorTree buildDominatorTree(const IrProcedure &ir,
+                                 const ControlFlowGraph &cfg) {
+  int blocks = ir.blocks.size();
+  DominatorTree tree;
+  tree.idom.assign(blocks, -1);
+  tree.enter.assign(blocks, 0);
+  tree.exit.assign(blocks, 0);
+  if (blocks == 0) {
+    return tree;
+  }
+
+  // walks up from two blocks to their nearest common dominator; blocks
+  // closer to the entry have higher postorder numbers
+  auto intersect = [&](std::int32_t a, std::int32_t b) {
+    while (a != b) {
+      while (cfg.postorderNumber[a] < cfg.postorderNumber[b]) {
+        a = tree.idom[a];
+      }
+      while (cfg.postorderNumber[b] < cfg.postorderNumber[a]) {
+        b = tree.idom[b];
+      }
+    }
+    return a;
+  };
+  tree.idom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::int32_t b : cfg.reversePostorder) {
+      if (b == 0) {
+        continue;
+      }
+      std::int32_t idom = -1;
+      for (std::uint32_t i = cfg.predecessorBegin[b];
+           i < cfg.predecessorBegin[b + 1]; ++i) {
+        std::int32_t p = cfg.predecessors[i];
+        if (tree.idom[p] < 0) {
+          continue;
+        }
+        idom = idom < 0 ? p : intersect(p, idom);
+      }
+      if (tree.idom[b] != idom) {
+        tree.idom[b] = idom;
+        changed = true;
+      }
+    }
+  }
+
+  // number a depth-first walk of the tree; children in block order
+  std::vector<std::uint32_t> childBegin(blocks + 1, 0);
+  for (int b = 1; b < blocks; ++b) {
+    if (tree.idom[b] >= 0) {
+      ++childBegin[tree.idom[b] + 1];
+    }
+  }
+  for (int b = 0; b < blocks; ++b) {
+    childBegin[b + 1] += childBegin[b];
+  }
+  std::vector<std::int32_t> children(childBegin[blocks]);
+  std::vector<std::uint32_t> fill(childBegin.begin(), childBegin.end() - 1);
+  for (int b = 1; b < blocks; ++b) {
+    if (tree.idom[b] >= 0) {
+      children[fill[tree.idom[b]]++] = b;
+    }
+  }
+  std::uint32_t clock = 0;
+  std::vector<std::pair<std::int32_t, std::uint32_t>> stack{{0, 0}};
+  tree.enter[0] = clock++;
+  while (!stack.empty()) {
+    auto &[block, next] = stack.back();
+    if (childBegin[block] + next < childBegin[block + 1]) {
+      std::int32_t child = children[childBegin[block] + next++];
+      tree.enter[child] = clock++;
+      stack.push_back({child, 0});
+      continue;
+    }
+    tree.exit[block] = clock++;
+    stack.pop_back();
+  }
+  return tree;
+}
+
+Liveness computeLiveness(const IrProcedure &ir, const ControlFlowGraph &cfg) {
+  int blocks = ir.blocks.size();
+  Liveness live;
+  live.words = (ir.variables + 63) / 64;
+  std::uint32_t words = live.words;
+  live.liveIn.assign(blocks * words, 0);
+  live.liveOut.assign(blocks * words, 0);
+
+  // variables each block reads before writing (uses) and writes (defs)
+  std::vector<std::uint64_t> uses(blocks * words, 0);
+  std::vector<std::uint64_t> defs(blocks * words, 0);
+  for (int b = 0; b < blocks; ++b) {
+    std::uint64_t *use = uses.data() + b * words;
+    std::uint64_t *def = defs.data() + b * words;
+    for (std::uint32_t i = ir.blocks[b].begin; i < ir.blocks[b].end; ++i) {
+      const IrInstr &instr = ir.code[i];
+      forEachUse(ir, instr, [&](std::int32_t v) {
+        if (!ir.isTemporary(v) && !Liveness::contains(def, v)) {
+          use[v / 64] |= std::uint64_t(1) << (v % 64);
+        }
+      });
+      if (instr.dst != NO_VREG && !ir.isTemporary(instr.dst)) {
+        def[instr.dst / 64] |= std::uint64_t(1) << (instr.dst % 64);
+      }
+    }
+  }
+
+  // backward problem: visit blocks in postorder (successors first), then
+  // any unreachable ones, until nothing changes
+  std::vector<std::int32_t> order(cfg.reversePostorder.rbegin(),
+                                  cfg.reversePostorder.rend());
+  for (int b = blocks - 1; b >= 0; --b) {
+    if (!cfg.reachable(b)) {
+      order.push_back(b);
+    }
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::int32_t b : order) {
+      std::uint64_t *out = live.liveOut.data() + b * words;
+      std::uint64_t *in = live.liveIn.data() + b * words;
+      const std::uint64_t *use = uses.data() + b * words;
+      const std::uint64_t *def = defs.data() + b * words;
+      for (std::int32_t s : ir.blocks[b].successors) {
+        if (s < 0) {
+          continue;
+        }
+        const std::uint64_t *successorIn = live.liveIn.data() + s * words;
+        for (std::uint32_t w = 0; w < words; ++w) {
+          out[w] |= successorIn[w];
+        }
+      }
+      for (std::uint32_t w = 0; w < words; ++w) {
+        std::uint64_t value = use[w] | (out[w] & ~def[w]);
+        if (value != in[w]) {
+          in[w] = value;
+          changed = true;
+        }
+      }
+    }
+  }
+  return live;
+}
+
+LoopNest findLoops(const IrProcedure &ir, const ControlFlowGraph &cfg,
+                   const DominatorTree &dom) {
+  int blocks = ir.blocks.size();
+  LoopNest nest;
+  nest.depth.assign(blocks, 0);
+  // blocks already counted in the loop being walked carry its number
+  std::vector<std::int32_t> mark(blocks, -1);
+  std::vector<std::int32_t> work;
+  std::int32_t loop = 0;
+  for (int latch = 0; latch < blocks; ++latch) {
+    for (std::int32_t header : ir.blocks[latch].successors) {
+      if (header < 0 || !cfg.reachable(latch) ||
+          !dom.dominates(header, latch)) {
+        continue;
+      }
+      // walk backwards from the latch, stopping at the header
+      mark[header] = loop;
+      ++nest.depth[header];
+      work.push_back(latch);
+      while (!work.empty()) {
+        std::int32_t b = work.back();
+        work.pop_back();
+        if (mark[b] == loop) {
+          continue;
+        }
+        mark[b] = loop;
+        ++nest.depth[b];
+        for (std::uint32_t i = cfg.predecessorBegin[b];
+             i < cfg.predecessorBegin[b + 1]; ++i) {
+          work.push_back(cfg.predecessors[i]);
+        }
+      }
+      ++loop;
+    }
+  }
+  return nest;
+}
+
+} // namespace
+
+const ControlFlowGraph &controlFlow(const IrProcedure &ir) {
+  IrAnalyses &analyses = analysesOf(ir);
+  if (!analyses.cfg) {
+    analyses.cfg = buildControlFlowGraph(ir);
+  }
+  return *analyses.cfg;
+}
+
+const DominatorTree &dominators(const IrProcedure &ir) {
+  IrAnalyses &analyses = analysesOf(ir);
+  if (!analyses.dominators) {
+    analyses.dominators = buildDominatorTree(ir, controlFlow(ir));
+  }
+  return *analyses.dominators;
+}
+
+const Liveness &liveness(const IrProcedure &ir) {
+  IrAnalyses &analyses = analysesOf(ir);
+  if (!analyses.liveness) {
+    analyses.liveness = computeLiveness(ir, controlFlow(ir));
+  }
+  return *analyses.liveness;
+}
+
+const LoopNest &loops(const IrProcedure &ir) {
+  IrAnalyses &analyses = analysesOf(ir);
+  if (!analyses.loops) {
+    analyses.loops = findLoops(ir, controlFlow(ir), dominators(ir));
+  }
+  return *analyses.loops;
+}
+
+void invalidateAnalyses(IrProcedure &ir) { ir.analyses.reset(); }
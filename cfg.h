@@ -0,0 +1,78 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "ir.h"
+#include <cstdint>
+#include <vector>
+
+// Analyses of an IrProcedure. Each is computed the first time it is asked
+// for and cached in the procedure until invalidateAnalyses() is called; a
+// procedure is only analyzed by the thread generating it.
+
+// Control-flow graph of the basic blocks. Successors are in the blocks
+// themselves; the predecessors of block b are
+// predecessors[predecessorBegin[b] .. predecessorBegin[b + 1]).
+struct ControlFlowGraph {
+  std::vector<std::uint32_t> predecessorBegin;
+  std::vector<std::int32_t> predecessors;
+  // blocks reachable from the entry (block 0) in reverse postorder
+  std::vector<std::int32_t> reversePostorder;
+  // position of each block in a postorder of the reachable blocks, -1 for
+  // unreachable blocks
+  std::vector<std::int32_t> postorderNumber;
+
+  bool reachable(int block) const { return postorderNumber[block] >= 0; }
+};
+
+// Dominator tree, by the Cooper-Harvey-Kennedy iteration over reverse
+// postorder. idom[b] is the immediate dominator of b (the entry is its own,
+// unreachable blocks have -1). enter/exit number a depth-first walk of the
+// tree, so a dominates b iff a's interval contains b's.
+struct DominatorTree {
+  std::vector<std::int32_t> idom;
+  std::vector<std::uint32_t> enter;
+  std::vector<std::uint32_t> exit;
+
+  bool dominates(int a, int b) const {
+    return idom[a] >= 0 && idom[b] >= 0 && enter[a] <= enter[b] &&
+           exit[b] <= exit[a];
+  }
+};
+
+// Live variables at block boundaries, one bit per variable of the
+// procedure. Temporaries never outlive their block and variables kept in
+// the frame are not tracked, so neither appears in the sets.
+struct Liveness {
+  // 64-bit words per set
+  std::uint32_t words = 0;
+  // sets of block b start at b * words
+  std::vector<std::uint64_t> liveIn;
+  std::vector<std::uint64_t> liveOut;
+
+  const std::uint64_t *in(int block) const {
+    return liveIn.data() + block * words;
+  }
+  const std::uint64_t *out(int block) const {
+    return liveOut.data() + block * words;
+  }
+  static bool contains(const std::uint64_t *set, int var) {
+    return (set[var / 64] >> (var % 64)) & 1;
+  }
+};
+
+// Natural loops: an edge to a block that dominates its source closes a
+// loop made of the header and every block that reaches the source without
+// passing the header. depth[b] is the number of loops containing block b.
+struct LoopNest {
+  std::vector<std::uint32_t> depth;
+};
+
+const ControlFlowGraph &controlFlow(const IrProcedure &ir);
+const DominatorTree &dominators(const IrProcedure &ir);
+const Liveness &liveness(const IrProcedure &ir);
+const LoopNest &loops(const IrProcedure &ir);
+
+// Drops the cached analyses; to be called after changing the code
+void invalidateAnalyses(IrProcedure &ir);
+
+#endif // CFG_H
@@ -1,13 +1,18 @@
 #include "codegen.h"
+#include "cfg.h"
+#include "ir.h"
 #include "mipsinstr.h"
+#include "regalloc.h"
 #include "wlp4data.h"
+#include <algorithm>
+#include <atomic>
 #include <deque>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <sstream>
 #include <string>
-#include <unordered_set>
+#include <thread>
 #include <vector>
 
 /**************** Code Generation Implementation ****************/
@@ -22,16 +27,7 @@
  * - Register allocation
  */
 
-/*
- * Label Management
- * - label_set: Maintains set of used labels to prevent duplicates
- * - functionlabel_map: Maps function names to their assembly labels
- */
-std::unordered_set<std::string> label_set{"print", "init", "new", "delete",
-                                          "main"};
-std::map<std::string, std::string> functionlabel_map;
-
-void Rule::print(std::ostream &out) {
+void Rule::print(std::ostream &out) const {
   out << lhs << " ";
   if (rhs.empty()) {
     out << ".EMPTY";
@@ -49,322 +45,293 @@ void Rule::print(std::ostream &out) {
   out << std::endl;
 }
 
-void SLR1DFA::print(std::ostream &out) {
-  out << "Transitions:" << std::endl;
-  for (const auto &it : transitions) {
-    out << it.first.first << " " << it.first.second << " " << it.second
-        << std::endl;
-  }
-  out << "Reductions:" << std::endl;
-  for (const auto &it : reductions) {
-    out << it.first.first << " " << it.second << " " << it.first.second
-        << std::endl;
-  }
+void Token::print(std::ostream &out) const {
+  out << typeName() << ' ' << value << std::endl;
 }
 
-void Token::print(std::ostream &out) {
-  out << type << ' ' << value << std::endl;
+std::uint32_t ParseTree::addLeaf(const Token &t) {
+  std::uint32_t id = size();
+  symbol.push_back(t.kind);
+  rule.push_back(0);
+  firstChild.push_back(childIds.size());
+  childCount.push_back(0);
+  firstToken.push_back(tokens.size());
+  endToken.push_back(tokens.size() + 1);
+  type.emplace_back();
+  tokens.push_back(t);
+  return id;
 }
 
-Treenode::Treenode(Rule NTrule) : terminal{false}, NTrule(NTrule) {}
+std::uint32_t ParseTree::addNode(int r, const std::uint32_t *children,
+                                 std::size_t count) {
+  std::uint32_t id = size();
+  symbol.push_back(WLP4_PARSE_TABLE.ruleLhs[r]);
+  rule.push_back(r);
+  firstChild.push_back(childIds.size());
+  childCount.push_back(count);
+  // an empty rule covers the empty token range at the current position
+  firstToken.push_back(count ? firstToken[children[0]] : tokens.size());
+  endToken.push_back(count ? endToken[children[count - 1]] : tokens.size());
+  type.emplace_back();
+  childIds.insert(childIds.end(), children, children + count);
+  return id;
+}
 
-Treenode::Treenode(Token Ttoken) : terminal{true}, Ttoken(Ttoken) {}
+std::uint32_t ParseTree::subtreeBegin(std::uint32_t id) const {
+  // the leftmost leaf (or empty node) of a subtree is created first
+  while (childCount[id] != 0) {
+    id = childIds[firstChild[id]];
+  }
+  return id;
+}
 
-Treenode::~Treenode() {}
+std::size_t ParseTree::bytesUsed() const {
+  return size() * (sizeof(symbol[0]) + sizeof(rule[0]) +
+                   sizeof(firstChild[0]) + sizeof(childCount[0]) +
+                   sizeof(firstToken[0]) + sizeof(endToken[0]) +
+                   sizeof(type[0])) +
+         childIds.size() * sizeof(childIds[0]) +
+         tokens.size() * sizeof(tokens[0]);
+}
 
-std::shared_ptr<Treenode> Treenode::getChild(std::string lhs, int n) {
-  int index = 1;
+const Rule &Treenode::getRule() const {
+  return grammarRules()[tree->rule[id]];
+}
 
-  for (auto &it : children) {
-    if (it->terminal) {
-      if (it->Ttoken.type == lhs && n == index) {
-        return it;
-      } else if (it->Ttoken.type == lhs) {
-        index++;
-      }
+void annotateType(Treenode node, const ProcedureTable &pt,
+                  const VariableTable &vt) {
+  if (node.terminal()) {
+    return;
+  }
+  switch (node.production()) {
+  case RULE_EXPR_TERM:
+  case RULE_TERM_FACTOR:
+    node.setType(node.child(0).type());
+    break;
+  case RULE_EXPR_PLUS: {
+    ValueType exprType = node.child(0).type();
+    ValueType termType = node.child(2).type();
+    if (exprType == TYPE_INT && termType == TYPE_INT) {
+      node.setType(TYPE_INT);
+    } else if (exprType == TYPE_INT_PTR && termType == TYPE_INT) {
+      node.setType(TYPE_INT_PTR);
+    } else if (exprType == TYPE_INT && termType == TYPE_INT_PTR) {
+      node.setType(TYPE_INT_PTR);
     } else {
-      if (it->NTrule.lhs == lhs && n == index) {
-        return it;
-      } else if (it->NTrule.lhs == lhs) {
-        index++;
-      }
+      throw std::runtime_error("expr 'PLUS' derived type error");
     }
+    break;
   }
-  return nullptr;
-}
-
-void Treenode::annotateTypes(ProcedureTable &pt, VariableTable &vt) {
-  for (auto &it : children) {
-    it->annotateTypes(pt, vt);
+  case RULE_EXPR_MINUS: {
+    ValueType exprType = node.child(0).type();
+    ValueType termType = node.child(2).type();
+    if (exprType == TYPE_INT && termType == TYPE_INT) {
+      node.setType(TYPE_INT);
+    } else if (exprType == TYPE_INT_PTR && termType == TYPE_INT) {
+      node.setType(TYPE_INT_PTR);
+    } else if (exprType == TYPE_INT_PTR && termType == TYPE_INT_PTR) {
+      node.setType(TYPE_INT);
+    } else {
+      throw std::runtime_error("expr 'PLUS' derived type error");
+    }
+    break;
   }
-  if (!terminal) {
-    if (NTrule.lhs == "expr") {
-      if (NTrule.rhs.size() == 1) {
-        if (NTrule.rhs[0] == "term") {
-          type = children[0]->type;
-        }
-      } else if (NTrule.rhs.size() == 3) {
-        if (NTrule.rhs[0] == "expr" && NTrule.rhs[1] == "PLUS" &&
-            NTrule.rhs[2] == "term") {
-          std::string exprType = children[0]->type;
-          std::string termType = children[2]->type;
-          if (exprType == "int" && termType == "int") {
-            type = "int";
-          } else if (exprType == "int*" && termType == "int") {
-            type = "int*";
-          } else if (exprType == "int" && termType == "int*") {
-            type = "int*";
-          } else {
-            throw std::runtime_error("expr 'PLUS' derived type error");
-          }
-        } else if (NTrule.rhs[0] == "expr" && NTrule.rhs[1] == "MINUS" &&
-                   NTrule.rhs[2] == "term") {
-          std::string exprType = children[0]->type;
-          std::string termType = children[2]->type;
-          if (exprType == "int" && termType == "int") {
-            type = "int";
-          } else if (exprType == "int*" && termType == "int") {
-            type = "int*";
-          } else if (exprType == "int*" && termType == "int*") {
-            type = "int";
-          } else {
-            throw std::runtime_error("expr 'PLUS' derived type error");
-          }
-        }
-      }
-    } else if (NTrule.lhs == "term") {
-      if (NTrule.rhs.size() == 1) {
-        if (NTrule.rhs[0] == "factor") {
-          type = children[0]->type;
-        }
-      } else if (NTrule.rhs.size() == 3) {
-        type = "int";
-        if (children[0]->type != "int" || children[2]->type != "int") {
-          throw std::runtime_error("invalid term or factor in term expression");
-        }
-      }
-    } else if (NTrule.lhs == "factor") {
-      if (NTrule.rhs.size() == 1) {
-        if (NTrule.rhs[0] == "ID") {
-          Variable v = vt.get(children[0]->Ttoken.value);
-          type = v.type;
-        } else if (NTrule.rhs[0] == "NUM") {
-          type = "int";
-        } else if (NTrule.rhs[0] == "NULL") {
-          type = "int*";
-        }
-      } else if (NTrule.rhs.size() == 2) {
-        if (NTrule.rhs[0] == "AMP" && NTrule.rhs[1] == "lvalue") {
-          type = "int*";
-          if (children[1]->type != "int") {
-            throw std::runtime_error("invalid '&' address retrieval");
-          }
-        } else if (NTrule.rhs[0] == "STAR" && NTrule.rhs[1] == "factor") {
-          type = "int";
-          if (children[1]->type != "int*") {
-            throw std::runtime_error("invalid '*' address retrieval");
-          }
-        }
-      } else if (NTrule.rhs.size() == 3) {
-        if (NTrule.rhs[0] == "LPAREN" && NTrule.rhs[1] == "expr" &&
-            NTrule.rhs[2] == "RPAREN") {
-          type = children[1]->type;
-        } else if (NTrule.rhs[0] == "ID" && NTrule.rhs[1] == "LPAREN" &&
-                   NTrule.rhs[2] == "RPAREN") {
-          if (vt.table.find(children[0]->Ttoken.value) != vt.table.end()) {
-            throw std::runtime_error("function call on local variable");
-          }
-          Procedure p = pt.get(children[0]->Ttoken.value);
-          if (p.signature.size() != 0) {
-            throw std::runtime_error("invalid parameters");
-          }
-          type = "int";
-        }
-      } else if (NTrule.rhs.size() == 4) {
-        if (NTrule.rhs[0] == "ID" && NTrule.rhs[1] == "LPAREN" &&
-            NTrule.rhs[2] == "arglist" && NTrule.rhs[3] == "RPAREN") {
-          if (vt.table.find(children[0]->Ttoken.value) != vt.table.end()) {
-            throw std::runtime_error("function call on local variable");
-          }
-          Procedure p = pt.get(children[0]->Ttoken.value);
-          std::vector<std::string> argTypes = getArgTypes(children[2]);
-          if (p.signature.size() != argTypes.size()) {
-            throw std::runtime_error("invalid parameters incorrect amount");
-          }
-          for (int i = 0; i < argTypes.size(); i++) {
-            if (argTypes[i] != p.signature[i]) {
-              throw std::runtime_error("invalid parameters incorrect types");
-            }
-          }
-          type = "int";
-        }
-      } else if (NTrule.rhs.size() == 5) {
-        if (NTrule.rhs[0] == "NEW" && NTrule.rhs[1] == "INT" &&
-            NTrule.rhs[2] == "LBRACK" && NTrule.rhs[3] == "expr" &&
-            NTrule.rhs[4] == "RBRACK") {
-          type = "int*";
-          if (children[3]->type != "int") {
-            throw std::runtime_error("invalid 'new' address retrieval");
-          }
-        }
-      }
-    } else if (NTrule.lhs == "lvalue") {
-      if (NTrule.rhs.size() == 1) {
-        if (NTrule.rhs[0] == "ID") {
-          Variable v = vt.get(children[0]->Ttoken.value);
-          type = v.type;
-        }
-      } else if (NTrule.rhs.size() == 2) {
-        if (NTrule.rhs[0] == "STAR" && NTrule.rhs[1] == "factor") {
-          type = "int";
-          if (children[1]->type != "int*") {
-            throw std::runtime_error("invalid '*' address retrieval");
-          }
-        }
-      } else if (NTrule.rhs.size() == 3) {
-        if (NTrule.rhs[0] == "LPAREN" && NTrule.rhs[1] == "lvalue" &&
-            NTrule.rhs[2] == "RPAREN") {
-          type = children[1]->type;
-        }
+  case RULE_TERM_STAR:
+  case RULE_TERM_SLASH:
+  case RULE_TERM_PCT:
+    node.setType(TYPE_INT);
+    if (node.child(0).type() != TYPE_INT ||
+        node.child(2).type() != TYPE_INT) {
+      throw std::runtime_error("invalid term or factor in term expression");
+    }
+    break;
+  case RULE_FACTOR_ID:
+  case RULE_LVALUE_ID:
+    node.setType(vt.get(node.child(0).token().id).type);
+    break;
+  case RULE_FACTOR_NUM:
+    node.setType(TYPE_INT);
+    break;
+  case RULE_FACTOR_NULL:
+    node.setType(TYPE_INT_PTR);
+    break;
+  case RULE_FACTOR_AMP:
+    node.setType(TYPE_INT_PTR);
+    if (node.child(1).type() != TYPE_INT) {
+      throw std::runtime_error("invalid '&' address retrieval");
+    }
+    break;
+  case RULE_FACTOR_STAR:
+  case RULE_LVALUE_STAR:
+    node.setType(TYPE_INT);
+    if (node.child(1).type() != TYPE_INT_PTR) {
+      throw std::runtime_error("invalid '*' address retrieval");
+    }
+    break;
+  case RULE_FACTOR_PAREN:
+  case RULE_LVALUE_PAREN:
+    node.setType(node.child(1).type());
+    break;
+  case RULE_FACTOR_CALL: {
+    if (vt.contains(node.child(0).token().id)) {
+      throw std::runtime_error("function call on local variable");
+    }
+    const Procedure &p = pt.get(node.child(0).token().id);
+    if (p.signature.size() != 0) {
+      throw std::runtime_error("invalid parameters");
+    }
+    node.setType(TYPE_INT);
+    break;
+  }
+  case RULE_FACTOR_CALL_ARGS: {
+    if (vt.contains(node.child(0).token().id)) {
+      throw std::runtime_error("function call on local variable");
+    }
+    const Procedure &p = pt.get(node.child(0).token().id);
+    Signature argTypes = getArgTypes(node.child(2));
+    if (p.signature.size() != argTypes.size()) {
+      throw std::runtime_error("invalid parameters incorrect amount");
+    }
+    for (int i = 0; i < argTypes.size(); i++) {
+      if (argTypes[i] != p.signature[i]) {
+        throw std::runtime_error("invalid parameters incorrect types");
       }
     }
+    node.setType(TYPE_INT);
+    break;
+  }
+  case RULE_FACTOR_NEW:
+    node.setType(TYPE_INT_PTR);
+    if (node.child(3).type() != TYPE_INT) {
+      throw std::runtime_error("invalid 'new' address retrieval");
+    }
+    break;
+  default:
+    break;
   }
 }
 
-void Treenode::print(std::ostream &out, std::string prefix) {
-  if (terminal) {
-    Ttoken.print(out);
-  } else {
-    NTrule.print(out);
-  }
-  for (const auto &child : children) {
-    child->print(out);
+void Treenode::print(std::ostream &out) const {
+  // pre-order with an explicit stack
+  std::vector<Treenode> work{*this};
+  while (!work.empty()) {
+    Treenode node = work.back();
+    work.pop_back();
+    if (node.terminal()) {
+      node.token().print(out);
+    } else {
+      node.getRule().print(out);
+    }
+    for (std::size_t i = node.childCount(); i-- > 0;) {
+      work.push_back(node.child(i));
+    }
   }
 }
 
-void Treenode::debugPrint(std::ostream &out, std::string prefix) {
-  if (terminal) {
-    Ttoken.print(out);
-  } else {
-    NTrule.print(out);
-  }
-  for (size_t i = 0; i < children.size(); ++i) {
-    if (i == children.size() - 1) {
-      out << prefix << "╰─";
-      children[i]->debugPrint(out, prefix + "  ");
+void Treenode::debugPrint(std::ostream &out, std::string prefix) const {
+  // each entry holds the connector printed before the node and the prefix
+  // for its children
+  struct Item {
+    Treenode node;
+    std::string lead;
+    std::string prefix;
+  };
+  std::vector<Item> work{{*this, "", prefix}};
+  while (!work.empty()) {
+    Item item = std::move(work.back());
+    work.pop_back();
+    out << item.lead;
+    if (item.node.terminal()) {
+      item.node.token().print(out);
     } else {
-      out << prefix << "├─";
-      children[i]->debugPrint(out, prefix + "│ ");
+      item.node.getRule().print(out);
+    }
+    for (std::size_t i = item.node.childCount(); i-- > 0;) {
+      bool last = i == item.node.childCount() - 1;
+      work.push_back({item.node.child(i),
+                      item.prefix + (last ? "╰─" : "├─"),
+                      item.prefix + (last ? "  " : "│ ")});
     }
   }
 }
 
-Variable::Variable(std::shared_ptr<Treenode> tree) {
-  name = tree->children[1]->Ttoken.value;
-  type = (tree->children[0]->children.size() == 1 ? "int" : "int*");
+Variable::Variable(Treenode tree) {
+  id = tree.child(1).token().id;
+  name = tree.child(1).token().value;
+  type = (tree.child(0).childCount() == 1 ? TYPE_INT : TYPE_INT_PTR);
 }
 
-void Variable::print(std::ostream &out) {
-  out << type << " " << name << std::endl;
+void Variable::print(std::ostream &out) const {
+  out << VALUE_TYPE_NAMES[type] << " " << name << std::endl;
 }
 
-void VariableTable::add(Variable v) {
-  if (table.find(v.name) != table.end()) {
+void VariableTable::add(const Variable &v) {
+  if (!slots.emplace(v.id, variables.size()).second) {
     throw std::runtime_error("duplicate variable declaration");
-  } else {
-    table.insert({v.name, v});
   }
+  variables.push_back(v);
 }
 
-Variable VariableTable::get(std::string name) {
-  if (table.find(name) == table.end()) {
+const Variable &VariableTable::get(std::uint32_t id) const {
+  auto it = slots.find(id);
+  if (it == slots.end()) {
     throw std::runtime_error("use of undeclared variable");
-  } else {
-    return table.at(name);
   }
+  return variables[it->second];
 }
 
-void VariableTable::print(std::ostream &out) {
+void VariableTable::print(std::ostream &out) const {
   out << "VARIABLES:" << std::endl;
-  for (auto it : table) {
-    out << it.first << " : ";
-    it.second.print(out);
-  }
-}
-
-Procedure::Procedure(std::shared_ptr<Treenode> tree) {
-  std::vector<std::shared_ptr<Treenode>> locDCLS =
-      getDeclarations(tree->getChild("dcls"));
-  std::vector<std::shared_ptr<Treenode>> params;
-
-  // acquires the procedure's parameters
-  if (tree->NTrule.lhs == "procedure") {
-    params = getDeclarations(tree->getChild("params", 1));
-  } else {
-    params.push_back(tree->getChild("dcl", 1));
-    params.push_back(tree->getChild("dcl", 2));
-    if (params[1]->children[0]->children.size() != 1) {
-      throw std::runtime_error("main invalid second parameter declaration");
-    }
-  }
-
-  // for each parameter, we push back the signature with the type name
-  for (auto it : params) {
-    Variable v = Variable(it);
-    symbolTable.add(v);
-    signature.push_back(v.type);
-  }
-
-  // set name to the procedure's name
-  name = tree->children[1]->Ttoken.value;
-
-  for (auto it : locDCLS) {
-    Variable v = Variable(it);
-    symbolTable.add(v);
+  for (const Variable &v : variables) {
+    out << v.name << " : ";
+    v.print(out);
   }
 }
 
-void Procedure::print(std::ostream &out) {
+void Procedure::print(std::ostream &out) const {
   out << "Procedure " << name << ":" << std::endl;
   out << "  Signature: ";
-  for (auto it : signature) {
-    out << it << " ";
+  for (std::size_t i = 0; i < signature.size(); ++i) {
+    out << VALUE_TYPE_NAMES[signature[i]] << " ";
   }
   out << "\n  Declarations:\n";
-  for (auto it : symbolTable.table) {
-    out << "    " << it.first << " : ";
-    it.second.print(out);
+  for (const Variable &v : symbolTable.variables) {
+    out << "    " << v.name << " : ";
+    v.print(out);
   }
 }
 
-void ProcedureTable::add(Procedure p) {
-  if (table.find(p.name) != table.end()) {
+const Procedure &ProcedureTable::add(Procedure p) {
+  if (p.id >= slots.size()) {
+    slots.resize(p.id + 1, 0);
+  }
+  if (slots[p.id] != 0) {
     throw std::runtime_error("duplicate procedure declaration");
-  } else {
-    table.insert({p.name, p});
   }
+  procedures.push_back(std::move(p));
+  slots[procedures.back().id] = procedures.size();
+  return procedures.back();
 }
 
-Procedure ProcedureTable::get(std::string name) {
-  if (table.find(name) == table.end()) {
+const Procedure &ProcedureTable::get(std::uint32_t id) const {
+  if (id >= slots.size() || slots[id] == 0) {
     throw std::runtime_error("use of undeclared procedure");
-  } else {
-    return table.at(name);
   }
+  return procedures[slots[id] - 1];
 }
 
-void ProcedureTable::print(std::ostream &out) {
+void ProcedureTable::print(std::ostream &out) const {
   out << "PROCEDURES:" << std::endl;
-  for (auto it : table) {
-    out << it.first << " : ";
-    it.second.print(out);
+  for (const Procedure &p : procedures) {
+    out << p.name << " : ";
+    p.print(out);
   }
 }
 
-std::vector<Rule> getRules(std::string input) {
+std::vector<Rule> getRules(std::string_view input) {
   std::vector<std::string> processedInput;
   std::string currLine;
-  std::istringstream iss{WLP4_CFG};
+  std::istringstream iss{std::string(input)};
 
   std::getline(iss, currLine);
   while (std::getline(iss, currLine)) {
@@ -393,932 +360,726 @@ std::vector<Rule> getRules(std::string input) {
   return rules;
 }
 
-SLR1DFA buildDFA(std::string transitions, std::string reductions) {
-  std::istringstream tiss{transitions};
-  std::istringstream riss{reductions};
-  std::map<std::pair<int, std::string>, int> transitionsMap;
-  std::map<std::pair<int, std::string>, int> reductionsMap;
-  std::string currLine;
+const std::vector<Rule> &grammarRules() {
+  static const std::vector<Rule> rules = getRules(WLP4_CFG);
+  return rules;
+}
 
-  getline(tiss, currLine);
-  while (getline(tiss, currLine)) {
-    std::istringstream iss{currLine};
-    int currState;
-    std::string symbol;
-    int nextState;
+void reduceTrees(std::vector<std::uint32_t> &trees, int rule,
+                 ParseTree &tree) {
+  // the children are the top len trees on the stack
+  std::uint32_t len = WLP4_PARSE_TABLE.ruleLength[rule];
+  std::uint32_t id = tree.addNode(rule, trees.data() + trees.size() - len, len);
+  trees.resize(trees.size() - len);
+  trees.push_back(id);
+}
 
-    iss >> currState >> symbol >> nextState;
-    transitionsMap.insert({std::make_pair(currState, symbol), nextState});
-  }
+void reduceStates(std::vector<int> &states, int rule) {
+  states.resize(states.size() - WLP4_PARSE_TABLE.ruleLength[rule]);
+  ParseAction go =
+      WLP4_PARSE_TABLE.action(states.back(), WLP4_PARSE_TABLE.ruleLhs[rule]);
+  states.push_back(actionState(go));
+}
 
-  getline(riss, currLine);
-  while (getline(riss, currLine)) {
-    std::istringstream iss{currLine};
-    int currState;
-    std::string symbol;
-    int ruleNum;
+void shift(const Token &topToken, std::vector<std::uint32_t> &trees,
+           std::vector<int> &states, ParseTree &tree) {
+  trees.push_back(tree.addLeaf(topToken));
 
-    iss >> currState >> ruleNum >> symbol;
-    reductionsMap.insert({std::make_pair(currState, symbol), ruleNum});
+  ParseAction action = WLP4_PARSE_TABLE.action(states.back(), topToken.kind);
+  if (!isShift(action)) {
+    throw std::runtime_error("No next transition");
   }
-
-  SLR1DFA dfa;
-  dfa.transitions = transitionsMap;
-  dfa.reductions = reductionsMap;
-  return dfa;
+  states.push_back(actionState(action));
 }
 
-std::deque<Token> convertInput(std::istream &in) {
-  std::deque<Token> tokens;
-  std::string currLine;
-  Token tok;
-  tok.type = "BOF";
-  tok.value = "BOF";
-  tokens.push_back(tok);
-  while (getline(in, currLine)) {
-    std::istringstream iss{currLine};
-    std::string type;
-    std::string value;
-    iss >> type >> value;
-    tok.type = type;
-    tok.value = value;
-    tokens.push_back(tok);
+Signature getArgTypes(Treenode tree) {
+  // arglist expr | arglist expr COMMA arglist
+  Signature argTypes;
+  for (Treenode arglist = tree;;) {
+    argTypes.push_back(arglist.child(0).type());
+    if (arglist.production() != RULE_ARGLIST_COMMA) {
+      return argTypes;
+    }
+    arglist = arglist.child(2);
   }
-  tok.type = "EOF";
-  tok.value = "EOF";
-  tokens.push_back(tok);
-  return tokens;
 }
 
-std::deque<Token> convertInput(std::vector<Token> &tokVec) {
-  std::deque<Token> tokens;
-  std::string currLine;
-  Token tok;
-  tok.type = "BOF";
-  tok.value = "BOF";
-  tokens.push_back(tok);
-  for (auto i : tokVec) {
-    tokens.push_back(i);
+void SemanticAnalyzer::report(ErrorRank rank, const char *message) {
+  if (errorRank == NO_ERROR || rank < errorRank) {
+    errorRank = rank;
+    error = message;
   }
-  tok.type = "EOF";
-  tok.value = "EOF";
-  tokens.push_back(tok);
-  return tokens;
 }
 
-void reduceTrees(std::vector<std::shared_ptr<Treenode>> &trees, const Rule r) {
-  std::shared_ptr<Treenode> newRule = std::make_shared<Treenode>(r);
-  int len = r.rhs.size();
-
-  for (int i = trees.size() - len; i < trees.size(); i++) {
-    newRule->children.push_back(std::move(trees[i]));
+void SemanticAnalyzer::shifted(const Token &t) {
+  if (!named && (t.kind == TK_ID || t.kind == TK_WAIN)) {
+    name = t;
+    named = true;
   }
+}
 
-  for (int i = 0; i < len; ++i) {
-    trees.pop_back();
+void SemanticAnalyzer::beginBody() {
+  // every parameter has been declared once the empty dcls that starts the
+  // body is reduced
+  inParams = false;
+  if (name.kind == TK_WAIN && signature[1] != TYPE_INT) {
+    report(RANK_MAIN_PARAMETER, "main invalid second parameter declaration");
+  }
+  try {
+    pt.add(Procedure{name.id, name.value, signature, {}});
+  } catch (std::runtime_error &err) {
+    report(RANK_DUPLICATE_PROCEDURE, err.what());
   }
-
-  trees.push_back(std::move(newRule));
 }
 
-void reduceStates(std::vector<int> &states, const Rule r, SLR1DFA &dfa) {
-  int len = r.rhs.size();
-
-  for (int i = 0; i < len; ++i) {
-    states.pop_back();
+void SemanticAnalyzer::endProcedure(Treenode node) {
+  // expr is child 9 of a procedure and child 11 of main
+  Treenode expr = node.child(node.production() == RULE_PROCEDURE ? 9 : 11);
+  if (expr.type() != TYPE_INT) {
+    report(RANK_RETURN,
+           "expression derived from procedure/main must return int");
   }
-
-  std::pair<int, std::string> key = std::make_pair(states.back(), r.lhs);
-  states.push_back(dfa.transitions[key]);
+  if (errorRank != NO_ERROR) {
+    failed = true;
+    return;
+  }
+  pt.procedures.back().symbolTable = std::move(vars);
+  vars = VariableTable{};
+  signature = Signature{};
+  named = false;
+  inParams = true;
 }
 
-void shift(std::deque<Token> &tokens,
-           std::vector<std::shared_ptr<Treenode>> &trees,
-           std::vector<int> &states, SLR1DFA &dfa) {
-  Token topToken = tokens.front();
-  std::shared_ptr<Treenode> newNode = std::make_shared<Treenode>(topToken);
-  trees.push_back(std::move(newNode));
+void SemanticAnalyzer::reduced(Treenode node) {
+  if (failed) {
+    return;
+  }
+  switch (node.production()) {
+  case RULE_DCL: {
+    Variable v{node};
+    if (inParams) {
+      signature.push_back(v.type);
+    }
+    try {
+      vars.add(v);
+    } catch (std::runtime_error &err) {
+      report(RANK_DUPLICATE_VARIABLE, err.what());
+    }
+    break;
+  }
+  case RULE_DCLS_EMPTY:
+    beginBody();
+    break;
+  case RULE_DCLS_NUM:
+  case RULE_DCLS_NULL: {
+    // dcls dcls dcl BECOMES NUM|NULL SEMI, where dcl is type ID
+    bool isInt = node.child(1).child(0).production() == RULE_TYPE_INT;
+    if (isInt != (node.production() == RULE_DCLS_NUM)) {
+      report(RANK_INITIALIZER, "incorrect assignment in declaration");
+    }
+    break;
+  }
+  case RULE_PROCEDURE:
+  case RULE_MAIN:
+    endProcedure(node);
+    break;
+  default:
+    try {
+      annotateType(node, pt, vars);
+    } catch (std::runtime_error &err) {
+      report(RANK_TYPE, err.what());
+    }
+    try {
+      checkStatementOrTest(node);
+    } catch (std::runtime_error &err) {
+      report(RANK_STATEMENT, err.what());
+    }
+  }
+}
 
-  int currState = states.back();
-  std::pair<int, std::string> key = std::make_pair(currState, topToken.type);
-  if (dfa.transitions.find(key) == dfa.transitions.end()) {
-    throw std::runtime_error("No next transition");
-  } else {
-    states.push_back(dfa.transitions[key]);
+void checkStatementOrTest(Treenode tree) {
+  if (tree.terminal()) {
+    return;
+  }
+  switch (tree.production()) {
+  case RULE_STATEMENT_ASSIGN:
+    if (tree.child(0).type() != tree.child(2).type()) {
+      throw std::runtime_error(
+          "lvalue and expression must have the same type");
+    }
+    break;
+  case RULE_STATEMENT_PRINTLN:
+    if (tree.child(2).type() != TYPE_INT) {
+      throw std::runtime_error(
+          "expression derived from PRINTLN must be of type int");
+    }
+    break;
+  case RULE_STATEMENT_DELETE:
+    if (tree.child(3).type() != TYPE_INT_PTR) {
+      throw std::runtime_error(
+          "expression derived from DELETE must be of type int*");
+    }
+    break;
+  case RULE_TEST_EQ:
+  case RULE_TEST_NE:
+  case RULE_TEST_LT:
+  case RULE_TEST_LE:
+  case RULE_TEST_GE:
+  case RULE_TEST_GT:
+    if (tree.child(0).type() != tree.child(2).type()) {
+      throw std::runtime_error(
+          "expression derived from test must have the same type");
+    }
+    break;
+  default:
+    break;
   }
+}
 
-  tokens.pop_front();
+/*
+ * Label names
+ * - F name: entry label of user procedure name. WLP4 identifiers are
+ *   letters and digits, so these never collide with main or the runtime
+ *   imports (print, init, new, delete).
+ * - P i L n: label n of the i-th procedure of the program; labels 0 up to
+ *   the number of blocks name the blocks of its IR
+ * Names depend only on the procedure being generated, so the output is the
+ * same on every platform and for any number of code generation threads.
+ */
+std::string generateLabel(CodeContext &ctx) {
+  return "P" + std::to_string(ctx.procedure) + "L" +
+         std::to_string(ctx.labelCount++);
 }
 
-std::vector<std::shared_ptr<Treenode>>
-getDeclarations(std::shared_ptr<Treenode> tree) {
-  std::vector<std::shared_ptr<Treenode>> declarations;
-  if (!tree->terminal) {
-    if (tree->NTrule.lhs == "dcls" && tree->NTrule.rhs.size() != 0) {
+std::string procedureLabel(std::string_view name) {
+  return "F" + std::string(name);
+}
 
-      std::vector<std::shared_ptr<Treenode>> d =
-          getDeclarations(tree->children[1]);
-      if (d.size() != 0) {
-        if ((d.front()->children[0]->children.size() == 1 &&
-             tree->NTrule.rhs[3] == "NULL") ||
-            (d.front()->children[0]->children.size() == 2 &&
-             tree->NTrule.rhs[3] == "NUM")) {
-          throw std::runtime_error("incorrect assignment in declaration");
-        }
-      }
-      declarations.insert(declarations.end(), d.begin(), d.end());
-      std::vector<std::shared_ptr<Treenode>> d1 =
-          getDeclarations(tree->children[0]);
-      declarations.insert(declarations.end(), d1.begin(), d1.end());
-    } else {
-      if (tree->NTrule.lhs == "dcl") {
-        declarations.push_back(tree);
-      } else {
-        for (auto child : tree->children) {
-          std::vector<std::shared_ptr<Treenode>> d = getDeclarations(child);
-          declarations.insert(declarations.end(), d.begin(), d.end());
-        }
-      }
-    }
+namespace {
+
+// Frame offset from $29 of a vreg in memory: parameters above $29, pushed
+// by the caller, the slots of the others from $29 down
+int frameOffset(const IrProcedure &ir, const RegisterAllocation &allocation,
+                std::int32_t vreg) {
+  if (vreg < ir.params) {
+    return 4 * (ir.params - vreg);
   }
-  return declarations;
+  return -4 * allocation.frameSlots[vreg];
 }
 
-std::vector<std::string> getArgTypes(std::shared_ptr<Treenode> tree) {
-  std::vector<std::string> argTypes;
-  if (!tree->terminal) {
-    if (tree->NTrule.lhs == "expr") {
-      argTypes.push_back(tree->type);
-    } else {
-      for (auto child : tree->children) {
-        std::vector<std::string> at = getArgTypes(child);
-        argTypes.insert(argTypes.end(), at.begin(), at.end());
-      }
-    }
+// Loads the frame word at offset from $29 into reg. lw and sw take a 16-bit
+// offset; words beyond that are addressed through reg itself.
+void loadFrame(CodeContext &ctx, int reg, int offset) {
+  if (offset >= -32768 && offset <= 32767) {
+    Load(ctx.out, reg, 29, offset);
+    return;
   }
-  return argTypes;
+  Lis(ctx.out, reg);
+  Word(ctx.out, offset);
+  Add(ctx.out, reg, 29, reg);
+  Load(ctx.out, reg, reg, 0);
 }
 
-void collectProcedures(std::shared_ptr<Treenode> tree, ProcedureTable &pt) {
-  if (!tree->terminal) {
-    if (tree->NTrule.lhs == "procedure" || tree->NTrule.lhs == "main") {
-      Procedure p{tree};
-      pt.add(p);
-      tree->annotateTypes(pt, p.symbolTable);
-      checkStatementsAndTests(tree);
-      if (tree->getChild("expr")->type != "int") {
-        throw std::runtime_error(
-            "expression derived from procedure/main must return int");
-      }
-    } else if (tree->NTrule.lhs == "procedures") {
-      for (auto child : tree->children) {
-        collectProcedures(child, pt);
-      }
-    }
+// Stores reg to the frame word at offset from $29, addressing words beyond
+// a 16-bit offset through $2
+void storeFrame(CodeContext &ctx, int reg, int offset) {
+  if (offset >= -32768 && offset <= 32767) {
+    Store(ctx.out, reg, 29, offset);
+    return;
   }
+  Lis(ctx.out, 2);
+  Word(ctx.out, offset);
+  Add(ctx.out, 2, 29, 2);
+  Store(ctx.out, reg, 2, 0);
 }
 
-void checkStatementsAndTests(std::shared_ptr<Treenode> tree) {
-  if (!tree->terminal) {
-    if (tree->NTrule.lhs == "statement") {
-      if (tree->NTrule.rhs.size() == 4) {
-        if (tree->NTrule.rhs[0] == "lvalue" &&
-            tree->NTrule.rhs[1] == "BECOMES" && tree->NTrule.rhs[2] == "expr" &&
-            tree->NTrule.rhs[3] == "SEMI") {
-          if (tree->children[0]->type != tree->children[2]->type) {
-            throw std::runtime_error(
-                "lvalue and expression must have the same type");
-          }
-        }
-      } else if (tree->NTrule.rhs.size() == 5) {
-        if (tree->NTrule.rhs[0] == "PRINTLN" &&
-            tree->NTrule.rhs[1] == "LPAREN" && tree->NTrule.rhs[2] == "expr" &&
-            tree->NTrule.rhs[3] == "RPAREN" && tree->NTrule.rhs[4] == "SEMI") {
-          if (tree->children[2]->type != "int") {
-            throw std::runtime_error(
-                "expression derived from PRINTLN must be of type int");
-          }
-        } else if (tree->NTrule.rhs[0] == "DELETE" &&
-                   tree->NTrule.rhs[1] == "LBRACK" &&
-                   tree->NTrule.rhs[2] == "RBRACK" &&
-                   tree->NTrule.rhs[3] == "expr" &&
-                   tree->NTrule.rhs[4] == "SEMI") {
-          if (tree->children[3]->type != "int*") {
-            throw std::runtime_error(
-                "expression derived from DELETE must be of type int*");
-          }
-        }
-      }
-    } else if (tree->NTrule.lhs == "test") {
-      if (tree->NTrule.rhs.size() == 3) {
-        if (tree->NTrule.rhs[0] == "expr" && tree->NTrule.rhs[2] == "expr") {
-          if (tree->children[0]->type != tree->children[2]->type) {
-            throw std::runtime_error(
-                "expression derived from test must have the same type");
-          }
-        }
-      }
-    }
-  }
+std::string blockLabel(const CodeContext &ctx, int block) {
+  return "P" + std::to_string(ctx.procedure) + "L" + std::to_string(block);
+}
 
-  for (auto &it : tree->children) {
-    checkStatementsAndTests(it);
+// Copies register reg to $1, the argument of runtime calls
+void setRuntimeArgument(CodeContext &ctx, int reg) {
+  if (reg != 1) {
+    Add(ctx.out, 1, reg, 0);
   }
 }
 
-std::shared_ptr<Treenode> getNode(std::shared_ptr<Treenode> tree,
-                                  std::string type) {
-  if (tree->terminal) {
-    if (tree->Ttoken.type == type) {
-      return tree;
-    } else {
-      return nullptr;
+// Calls runtime procedure name with $1 already set
+void callRuntime(CodeContext &ctx, std::string_view name) {
+  push(ctx.out, 31);
+  Lis(ctx.out, 31);
+  Word(ctx.out, name);
+  Jalr(ctx.out, 31);
+  pop(ctx.out, 31);
+}
+
+} // namespace
+
+/*
+ * selectInstructions: Generates MIPS assembly for the IR of a procedure
+ * - vregs live in the registers allocateRegisters gives them, up to the
+ *   instruction they are split at if any; the others are loaded into $3 and
+ *   $5 when read and computed in $3
+ * - $2 holds small constants and $1 the argument of runtime calls, which
+ *   preserve every register but $3
+ * - Procedures get their arguments on the stack and return in $3; the
+ *   caller saves $29, $31 and the registers it needs after the call
+ */
+void selectInstructions(const IrProcedure &ir, CodeContext &ctx) {
+  RegisterAllocation allocation = allocateRegisters(ir);
+  // the instruction being generated
+  std::uint32_t at = 0;
+  // register of vreg at the current instruction, if it has one there
+  auto registerOf = [&](std::int32_t vreg) -> int {
+    return at < allocation.splitAt[vreg] ? allocation.registers[vreg]
+                                         : NO_REGISTER;
+  };
+  // register holding vreg, loaded into scratch if vreg is in the frame
+  auto use = [&](std::int32_t vreg, int scratch) -> int {
+    int reg = registerOf(vreg);
+    if (reg != NO_REGISTER) {
+      return reg;
+    }
+    loadFrame(ctx, scratch, frameOffset(ir, allocation, vreg));
+    return scratch;
+  };
+  // register to compute vreg in
+  auto target = [&](std::int32_t vreg) -> int {
+    int reg = registerOf(vreg);
+    return reg != NO_REGISTER ? reg : 3;
+  };
+  // moves the value computed for vreg in reg to where vreg lives
+  auto define = [&](std::int32_t vreg, int reg) {
+    int home = registerOf(vreg);
+    if (home == NO_REGISTER) {
+      storeFrame(ctx, reg, frameOffset(ir, allocation, vreg));
+    } else if (home != reg) {
+      Add(ctx.out, home, reg, 0);
     }
+  };
+
+  // block labels take the first label numbers of the procedure
+  ctx.labelCount = ir.blocks.size();
+  if (!ir.isMain()) {
+    // procedure INT ID LPAREN params RPAREN LBRACE dcls statements RETURN
+    // expr SEMI RBRACE
+    Label(ctx.out, procedureLabel(ir.procedure.child(1).token().value));
   } else {
-    if (tree->NTrule.lhs == type) {
-      return tree;
+    // main INT WAIN LPAREN dcl COMMA dcl RPAREN LBRACE dcls statements RETURN
+    // expr SEMI RBRACE
+    Label(ctx.out, "main");
+    // runs init if first param of main is of type int*
+    if (ir.procedure.child(3).type() == TYPE_INT_PTR) {
+      callRuntime(ctx, "init");
     } else {
-      std::shared_ptr<Treenode> find;
-      for (auto it : tree->children) {
-        find = getNode(it, type);
-        if (find) {
-          break;
-        }
-      }
-      return find;
+      push(ctx.out, 2);
+      Lis(ctx.out, 2);
+      Word(ctx.out, 0);
+      callRuntime(ctx, "init");
+      pop(ctx.out, 2);
     }
+    // the params of wain are stored to the stack like arguments
+    push(ctx.out, 1);
+    push(ctx.out, 2);
   }
-}
-
-std::string generateLabel() {
-  std::string newLabel;
-  do {
-    newLabel = "";
-    for (int i = 0; i < 10; ++i) {
-      newLabel += 'a' + rand() % 26;
+  // set value of frame pointer, then make room for the vregs in memory
+  Subtract(ctx.out, 29, 30, 4);
+  if (allocation.frameWords > 0) {
+    Lis(ctx.out, 3);
+    Word(ctx.out, 4 * allocation.frameWords);
+    Subtract(ctx.out, 30, 30, 3);
+  }
+  // parameters still needed move to their registers
+  const Liveness &live = liveness(ir);
+  for (int v = 0; v < ir.params; ++v) {
+    if (allocation.registers[v] != NO_REGISTER &&
+        Liveness::contains(live.in(0), v)) {
+      loadFrame(ctx, allocation.registers[v],
+                frameOffset(ir, allocation, v));
     }
-  } while (label_set.count(newLabel));
-  label_set.insert(newLabel);
-  return newLabel;
-}
+  }
 
-/*
- * generateCodeOther: Generates MIPS assembly for expressions and statements
- * - Handles arithmetic operations with type checking
- * - Manages memory operations and pointer arithmetic
- * - Implements control flow structures (if/while)
- * - Processes function calls with parameter passing
- */
-void generateCodeOther(std::shared_ptr<Treenode> tree, ProcedureTable &pt,
-                       std::map<std::string, int> offsetTable) {
-  if (!tree->terminal) {
-    if (tree->NTrule.lhs == "expr") {
-      // CODE GENERATION FOR EXPRESSIONS
-      std::shared_ptr<Treenode> expression = tree->getChild("expr");
-      std::shared_ptr<Treenode> term = tree->getChild("term");
-      if (tree->NTrule.rhs.size() > 1) {
-        std::shared_ptr<Treenode> operation = tree->getChild("PLUS")
-                                                  ? tree->getChild("PLUS")
-                                                  : tree->getChild("MINUS");
-        // push original 5 to stack since it will be modified
-        push(5);
-        // generate code for expression
-        generateCodeOther(expression, pt, offsetTable);
-        // store output into $3
-        push(3);
-        // generate code for expression
-        generateCodeOther(term, pt, offsetTable);
-        // load output from expression into $5
-        pop(5);
-        // output code for operation
-        if (expression->type == "int" && term->type == "int") {
-          if (operation->Ttoken.type == "PLUS") {
-            Add(3, 5, 3);
-          } else if (operation->Ttoken.type == "MINUS") {
-            Subtract(3, 5, 3);
-          } else {
-            // THIS SHOULD NEVER HAPPEN
-            throw std::runtime_error("valid operations not found");
-          }
-        } else if (expression->type == "int*" && term->type == "int") {
-          if (operation->Ttoken.type == "PLUS") {
-            Multiply(3, 4);
-            Mflo(3);
-            Add(3, 5, 3);
-          } else if (operation->Ttoken.type == "MINUS") {
-            Multiply(3, 4);
-            Mflo(3);
-            Subtract(3, 5, 3);
-          } else {
-            // THIS SHOULD NEVER HAPPEN
-            throw std::runtime_error("valid operations not found");
-          }
-        } else if (expression->type == "int" && term->type == "int*") {
-          if (operation->Ttoken.type == "PLUS") {
-            Multiply(5, 4);
-            Mflo(5);
-            Add(3, 5, 3);
-          } else if (operation->Ttoken.type == "MINUS") {
-            Multiply(5, 4);
-            Mflo(5);
-            Subtract(3, 5, 3);
-          } else {
-            // THIS SHOULD NEVER HAPPEN
-            throw std::runtime_error("valid operations not found");
-          }
-        } else if (expression->type == "int*" && term->type == "int*") {
-          if (operation->Ttoken.type == "MINUS") {
-            Subtract(3, 5, 3);
-            Divide(3, 4);
-            Mflo(3);
-          } else {
-            throw std::runtime_error("cannot add two int*'s");
-          }
-        }
-        // pop 5 from stack to restore
-        pop(5);
-      } else {
-        if (term) {
-          generateCodeOther(term, pt, offsetTable);
-        } else {
-          // this should never happen
-          throw std::runtime_error("expression must have at least one term");
-        }
+  std::size_t calls = 0;
+  std::size_t splits = 0;
+  for (std::size_t b = 0; b < ir.blocks.size(); ++b) {
+    const IrBlock &block = ir.blocks[b];
+    if (b != 0) {
+      Label(ctx.out, blockLabel(ctx, b));
+    }
+    for (std::uint32_t i = block.begin; i < block.end; ++i) {
+      const IrInstr &instr = ir.code[i];
+      // vregs split here move from their registers to the frame
+      for (; splits < allocation.splits.size() &&
+             allocation.splitAt[allocation.splits[splits]] == i;
+           ++splits) {
+        std::int32_t vreg = allocation.splits[splits];
+        storeFrame(ctx, allocation.registers[vreg],
+                   frameOffset(ir, allocation, vreg));
+      }
+      at = i;
+      switch (instr.op) {
+      case IR_CONST: {
+        int d = target(instr.dst);
+        Lis(ctx.out, d);
+        Word(ctx.out, instr.imm);
+        define(instr.dst, d);
+        break;
       }
-    } else if (tree->NTrule.lhs == "term") {
-      // CODE GENERATION FOR TERMS
-      std::shared_ptr<Treenode> term = tree->getChild("term");
-      std::shared_ptr<Treenode> factor = tree->getChild("factor");
-      if (tree->NTrule.rhs.size() > 1) {
-        std::shared_ptr<Treenode> operation = tree->getChild("STAR");
-        if (!operation) {
-          operation = tree->getChild("SLASH");
+      case IR_COPY:
+        define(instr.dst, use(instr.a, target(instr.dst)));
+        break;
+      case IR_ADD:
+      case IR_SUB:
+      case IR_LT:
+      case IR_LTU:
+      case IR_EQ:
+      case IR_NE: {
+        int a = use(instr.a, 3);
+        int b = use(instr.b, 5);
+        int d = target(instr.dst);
+        if (instr.op == IR_ADD) {
+          Add(ctx.out, d, a, b);
+        } else if (instr.op == IR_LT) {
+          Slt(ctx.out, d, a, b);
+        } else if (instr.op == IR_LTU) {
+          Sltu(ctx.out, d, a, b);
+        } else {
+          Subtract(ctx.out, d, a, b);
         }
-        if (!operation) {
-          operation = tree->getChild("PCT");
+        if (instr.op == IR_EQ) {
+          // a - b < 1 (unsigned) iff a == b
+          Lis(ctx.out, 2);
+          Word(ctx.out, 1);
+          Sltu(ctx.out, d, d, 2);
+        } else if (instr.op == IR_NE) {
+          Sltu(ctx.out, d, 0, d);
         }
-        push(5);
-        // generate code for term
-        generateCodeOther(term, pt, offsetTable);
-        // store output into $3
-        push(3);
-        // generate code for expression
-        generateCodeOther(factor, pt, offsetTable);
-        // load output from expression into $5
-        pop(5);
-        // output code for operation
-        if (operation->Ttoken.type == "STAR") {
-          Multiply(5, 3);
-          Mflo(3);
-        } else if (operation->Ttoken.type == "SLASH") {
-          Divide(5, 3);
-          Mflo(3);
-        } else if (operation->Ttoken.type == "PCT") {
-          Divide(5, 3);
-          Mfhi(3);
+        define(instr.dst, d);
+        break;
+      }
+      case IR_MUL:
+      case IR_DIV:
+      case IR_REM: {
+        int a = use(instr.a, 3);
+        int b = use(instr.b, 5);
+        int d = target(instr.dst);
+        if (instr.op == IR_MUL) {
+          Multiply(ctx.out, a, b);
+        } else {
+          Divide(ctx.out, a, b);
         }
-        pop(5);
-      } else {
-        if (factor) {
-          generateCodeOther(factor, pt, offsetTable);
+        if (instr.op == IR_REM) {
+          Mfhi(ctx.out, d);
+        } else {
+          Mflo(ctx.out, d);
         }
+        define(instr.dst, d);
+        break;
       }
-    } else if (tree->NTrule.lhs == "factor") {
-      // CODE GENERATION FOR FACTORS
-      if (tree->NTrule.rhs.size() == 1) {
-        if (tree->NTrule.rhs[0] == "ID") {
-          std::string ID = tree->getChild("ID")->Ttoken.value;
-          // std::cout << "CHILD ID IS: " << ID << std::endl;
-          Load(3, 29, offsetTable[ID]);
-        } else if (tree->NTrule.rhs[0] == "NUM") {
-          int val = std::stoi(tree->getChild("NUM")->Ttoken.value);
-          Lis(3);
-          Word(val);
-        } else if (tree->NTrule.rhs[0] == "NULL") {
-          // IDK IF THIS IS CORRECT PROBABLY IS MAYBE ISNT
-          int val = 1;
-          Lis(3);
-          Word(val);
+      case IR_SCALE:
+      case IR_UNSCALE: {
+        // $4 holds 4 throughout the program
+        int a = use(instr.a, 3);
+        int d = target(instr.dst);
+        if (instr.op == IR_SCALE) {
+          Multiply(ctx.out, a, 4);
+        } else {
+          Divide(ctx.out, a, 4);
         }
-      } else if (tree->NTrule.rhs.size() == 2) {
-        if (tree->NTrule.rhs[0] == "AMP" && tree->NTrule.rhs[1] == "lvalue") {
-          std::shared_ptr<Treenode> lvalue = tree->getChild("lvalue");
-          while (lvalue->children.size() == 3) {
-            lvalue = lvalue->getChild("lvalue");
-          }
-          if (lvalue->children.size() == 1) {
-            std::string name = lvalue->getChild("ID")->Ttoken.value;
-            int offset = offsetTable[name];
-            Lis(3);
-            Word(offset);
-            Add(3, 29, 3);
-          } else if (lvalue->children.size() == 2) {
-            generateCodeOther(lvalue->getChild("factor"), pt, offsetTable);
+        Mflo(ctx.out, d);
+        define(instr.dst, d);
+        break;
+      }
+      case IR_NOT: {
+        int a = use(instr.a, 3);
+        int d = target(instr.dst);
+        Lis(ctx.out, 2);
+        Word(ctx.out, 1);
+        Sltu(ctx.out, d, a, 2);
+        define(instr.dst, d);
+        break;
+      }
+      case IR_LOAD: {
+        int a = use(instr.a, 3);
+        int d = target(instr.dst);
+        Load(ctx.out, d, a, 0);
+        define(instr.dst, d);
+        break;
+      }
+      case IR_STORE: {
+        int a = use(instr.a, 3);
+        int b = use(instr.b, 5);
+        Store(ctx.out, b, a, 0);
+        break;
+      }
+      case IR_LOAD_VAR: {
+        int d = target(instr.dst);
+        loadFrame(ctx, d, frameOffset(ir, allocation, instr.imm));
+        define(instr.dst, d);
+        break;
+      }
+      case IR_STORE_VAR:
+        storeFrame(ctx, use(instr.a, 3),
+                   frameOffset(ir, allocation, instr.imm));
+        break;
+      case IR_ADDR_VAR: {
+        int d = target(instr.dst);
+        Lis(ctx.out, d);
+        Word(ctx.out, frameOffset(ir, allocation, instr.imm));
+        Add(ctx.out, d, 29, d);
+        define(instr.dst, d);
+        break;
+      }
+      case IR_CALL: {
+        std::uint32_t saved = allocation.savedAtCalls[calls++];
+        for (int r = 1; r < 32; ++r) {
+          if (saved >> r & 1) {
+            push(ctx.out, r);
           }
-        } else if (tree->NTrule.rhs[0] == "STAR" &&
-                   tree->NTrule.rhs[1] == "factor") {
-          // !!! MEMORY THING NOT SURE IF WORKS !!!
-          generateCodeOther(tree->getChild("factor"), pt, offsetTable);
-          Load(3, 3, 0);
         }
-      } else if (tree->NTrule.rhs.size() == 3) {
-        if (tree->NTrule.rhs[0] == "LPAREN" && tree->NTrule.rhs[1] == "expr" &&
-            tree->NTrule.rhs[2] == "RPAREN") {
-          std::shared_ptr<Treenode> expression = tree->getChild("expr");
-          generateCodeOther(expression, pt, offsetTable);
-          // !!! NOT 100% SURE THIS WILL WORK !!!
-        } else if (tree->NTrule.rhs[0] == "ID" &&
-                   tree->NTrule.rhs[1] == "LPAREN" &&
-                   tree->NTrule.rhs[2] == "RPAREN") {
-          // factor ID LPAREN RPAREN
-          push(29);
-          push(31);
-          Lis(31);
-          Word(functionlabel_map[tree->getChild("ID")->Ttoken.value]);
-          Jalr(31);
-          pop(31);
-          pop(29);
+        push(ctx.out, 29);
+        push(ctx.out, 31);
+        for (std::int32_t k = 0; k < instr.b; ++k) {
+          push(ctx.out, use(ir.args[instr.a + k], 3));
         }
-      } else if (tree->NTrule.rhs.size() == 4) {
-        if (tree->NTrule.rhs[0] == "ID" && tree->NTrule.rhs[1] == "LPAREN" &&
-            tree->NTrule.rhs[2] == "arglist" &&
-            tree->NTrule.rhs[3] == "RPAREN") {
-          // factor ID LPAREN arglist RPAREN
-          push(29);
-          push(31);
-          std::shared_ptr<Treenode> arglist = tree->getChild("arglist");
-          int args = 0;
-          // need to iterate through the arglist and push any arguments to stack
-          while (arglist) {
-            generateCodeOther(arglist->getChild("expr"), pt, offsetTable);
-            push(3);
-            args++;
-            arglist = arglist->getChild("arglist");
-          }
-          Lis(31);
-          Word(functionlabel_map[tree->getChild("ID")->Ttoken.value]);
-          Jalr(31);
-          // pop the args we sent
-          for (int i = 0; i < args; i++) {
-            pop();
+        Lis(ctx.out, 31);
+        Word(ctx.out, procedureLabel(ctx.pt.get(instr.imm).name));
+        Jalr(ctx.out, 31);
+        // pop the args we sent
+        for (std::int32_t k = 0; k < instr.b; ++k) {
+          pop(ctx.out);
+        }
+        pop(ctx.out, 31);
+        pop(ctx.out, 29);
+        for (int r = 31; r > 0; --r) {
+          if (saved >> r & 1) {
+            pop(ctx.out, r);
           }
-          pop(31);
-          pop(29);
         }
-      } else if (tree->NTrule.rhs.size() == 5) {
-        // factor NEW INT LBRACK expr RBRACK
-        generateCodeOther(tree->getChild("expr"), pt, offsetTable);
-        std::string endlabel = generateLabel();
-        push(1);
-        Add(1, 3, 0);
-        push(31);
-        Lis(31);
-        Word("new");
-        Jalr(31);
-        pop(31);
-        pop(1);
-        Bne(3, 0, endlabel);
-        Lis(3);
-        Word(1);
-        Label(endlabel);
+        define(instr.dst, 3);
+        break;
       }
-    } else if (tree->NTrule.lhs == "statements") {
-      // CODE GENERATION FOR STATEMENTS
-      // std::cout << "IN STATEMENTS" << std::endl;
-      if (tree->NTrule.rhs.size() == 0) {
-      } else if (tree->NTrule.rhs.size() == 2) {
-        // std::cout << "STATEMENTS SIZE 2" << std::endl;
-        generateCodeOther(tree->getChild("statements"), pt, offsetTable);
-        generateCodeOther(tree->getChild("statement"), pt, offsetTable);
+      case IR_PRINT:
+        setRuntimeArgument(ctx, use(instr.a, 1));
+        callRuntime(ctx, "print");
+        break;
+      case IR_NEW: {
+        // new returns 0 when it fails; that is NULL (1) in WLP4
+        std::string endlabel = generateLabel(ctx);
+        setRuntimeArgument(ctx, use(instr.a, 1));
+        callRuntime(ctx, "new");
+        Bne(ctx.out, 3, 0, endlabel);
+        Lis(ctx.out, 3);
+        Word(ctx.out, 1);
+        Label(ctx.out, endlabel);
+        define(instr.dst, 3);
+        break;
       }
-    } else if (tree->NTrule.lhs == "statement") {
-      // CODE GENERATION FOR STATEMENT
-      // statement lvalue BECOMES expr SEMI
-      // std::cout << "IN STATEMENT" << std::endl;
-      if (tree->NTrule.rhs.size() == 4) {
-        std::shared_ptr<Treenode> lvalue = tree->getChild("lvalue");
-        std::shared_ptr<Treenode> expr = tree->getChild("expr");
-        while (lvalue->children.size() == 3) {
-          lvalue = lvalue->getChild("lvalue");
-        }
-        if (lvalue->children.size() == 1) {
-          std::string name = lvalue->getChild("ID")->Ttoken.value;
-          int offset = offsetTable[name];
-          generateCodeOther(expr, pt, offsetTable);
-          Store(3, 29, offset);
-        } else if (lvalue->children.size() == 2) {
-          // !!! NEED THIS LATER BUT NOT NOW !!!
-          push(5);
-          generateCodeOther(lvalue->getChild("factor"), pt, offsetTable);
-          push(3);
-          generateCodeOther(expr, pt, offsetTable);
-          pop(5);
-          Store(3, 5, 0);
-          pop(5);
-        }
-      } else if (tree->NTrule.rhs.size() == 5) {
-        if (tree->NTrule.rhs[0] == "PRINTLN" &&
-            tree->NTrule.rhs[1] == "LPAREN" && tree->NTrule.rhs[2] == "expr" &&
-            tree->NTrule.rhs[3] == "RPAREN" && tree->NTrule.rhs[4] == "SEMI") {
-          // statement PRINTLN LPAREN expr RPAREN SEMI
-          generateCodeOther(tree->getChild("expr"), pt, offsetTable);
-          push(1);
-          Add(1, 3, 0);
-          push(31);
-          Lis(31);
-          Word("print");
-          Jalr(31);
-          pop(31);
-          pop(1);
-          // generateCodePrintln();
-        } else if (tree->NTrule.rhs[0] == "DELETE" &&
-                   tree->NTrule.rhs[1] == "LBRACK" &&
-                   tree->NTrule.rhs[2] == "RBRACK" &&
-                   tree->NTrule.rhs[3] == "expr" &&
-                   tree->NTrule.rhs[4] == "SEMI") {
-          // statement DELETE LBRACK RBRACK expr SEMI
-          generateCodeOther(tree->getChild("expr"), pt, offsetTable);
-          std::string skiplabel = generateLabel();
-          push(1);
-          Lis(1);
-          Word(1);
-          Beq(3, 1, skiplabel);
-          Add(1, 3, 0);
-          push(31);
-          Lis(31);
-          Word("delete");
-          Jalr(31);
-          pop(31);
-          Label(skiplabel);
-          pop(1);
-          // CHECK IF THIS WORKS WHEN I WAKE UP
-        }
-      } else if (tree->NTrule.rhs.size() == 7) {
-        // statement WHILE LPAREN test RPAREN LBRACE statements RBRACE
-        std::string beginlabel = generateLabel();
-        std::string endlabel = generateLabel();
-        // beginning of the while loop (before test is run)
-        Label(beginlabel);
-        // generates code for test
-        generateCodeOther(tree->getChild("test"), pt, offsetTable);
-        // if test is false, jump to end of while loop
-        Beq(3, 0, endlabel);
-        // otherwise generates code for statements
-        generateCodeOther(tree->getChild("statements"), pt, offsetTable);
-        // jump to beginning of while loop
-        Beq(0, 0, beginlabel);
-        // end of the while loop
-        Label(endlabel);
-
-        // !!! CONTINUE THIS IN A BIT !!!
-      } else if (tree->NTrule.rhs.size() == 11) {
-        // statement
-        // IF LPAREN test RPAREN LBRACE statements RBRACE
-        // ELSE LBRACE statements RBRACE
-
-        // label to jump to if test is false
-        std::string elselabel = generateLabel();
-        std::string endlabel = generateLabel();
-        generateCodeOther(tree->getChild("test"), pt, offsetTable);
-        Beq(3, 0, elselabel);
-        generateCodeOther(tree->getChild("statements"), pt, offsetTable);
-        Beq(0, 0, endlabel);
-        Label(elselabel);
-        generateCodeOther(tree->getChild("statements", 2), pt, offsetTable);
-        Label(endlabel);
+      case IR_DELETE: {
+        std::string skiplabel = generateLabel(ctx);
+        setRuntimeArgument(ctx, use(instr.a, 1));
+        Lis(ctx.out, 2);
+        Word(ctx.out, 1);
+        Beq(ctx.out, 1, 2, skiplabel);
+        callRuntime(ctx, "delete");
+        Label(ctx.out, skiplabel);
+        break;
       }
-    } else if (tree->NTrule.lhs == "test") {
-      std::shared_ptr<Treenode> left = tree->getChild("expr");
-      std::shared_ptr<Treenode> right = tree->getChild("expr", 2);
-      // get the operation since its always the 2nd child in test
-      std::string op = tree->children[1]->Ttoken.type;
-      push(5);
-      // result in $5
-      generateCodeOther(left, pt, offsetTable);
-      push(3);
-      // result in $3
-      generateCodeOther(right, pt, offsetTable);
-      pop(5);
-      if (op == "EQ") {
-        std::string labeltrue = generateLabel();
-        std::string labelfalse = generateLabel();
-        // test expr EQ expr
-        Bne(3, 5, labelfalse); // check this later not sure if pc is already +1
-        Lis(3);
-        Word(1);
-        Beq(0, 0, labeltrue);
-        Label(labelfalse);
-        Add(3, 0, 0);
-        Label(labeltrue);
-      } else if (op == "NE") {
-        std::string labeltrue = generateLabel();
-        std::string labelfalse = generateLabel();
-        // test expr NE expr
-        Beq(3, 5, labelfalse); // check this later not sure if pc is already +1
-        Lis(3);
-        Word(1);
-        Beq(0, 0, labeltrue);
-        Label(labelfalse);
-        Add(3, 0, 0);
-        Label(labeltrue);
-      } else if (op == "LT") {
-        // test expr LT expr
-        if (left->type == "int" && right->type == "int") {
-          Slt(3, 5, 3);
-        } else {
-          Sltu(3, 5, 3);
+      case IR_JUMP:
+        if (block.successors[0] != int(b) + 1) {
+          Beq(ctx.out, 0, 0, blockLabel(ctx, block.successors[0]));
         }
-      } else if (op == "LE") {
-        // test expr LE expr
-        if (left->type == "int" && right->type == "int") {
-          Slt(3, 3, 5); // will be 0 if less than equal
-          Lis(5);
-          Word(1);
-          Slt(3, 3, 5);
-        } else {
-          Sltu(3, 3, 5);
-          Lis(5);
-          Word(1);
-          Slt(3, 3, 5);
+        break;
+      case IR_BRANCH:
+        Beq(ctx.out, use(instr.a, 3), 0,
+            blockLabel(ctx, block.successors[1]));
+        if (block.successors[0] != int(b) + 1) {
+          Beq(ctx.out, 0, 0, blockLabel(ctx, block.successors[0]));
         }
-      } else if (op == "GE") {
-        // test expr GE expr
-        if (left->type == "int" && right->type == "int") {
-          Slt(3, 5, 3); // will be 0 if less than equal
-          Lis(5);
-          Word(1);
-          Slt(3, 3, 5);
-        } else {
-          Sltu(3, 5, 3);
-          Lis(5);
-          Word(1);
-          Slt(3, 3, 5);
+        break;
+      case IR_RET: {
+        int a = use(instr.a, 3);
+        if (a != 3) {
+          Add(ctx.out, 3, a, 0);
         }
-      } else if (op == "GT") {
-        // test expr GT expr
-        if (left->type == "int" && right->type == "int") {
-          Slt(3, 3, 5);
-        } else {
-          Sltu(3, 3, 5);
+        // release the frame, and for wain its params
+        Add(ctx.out, 30, 29, 4);
+        if (ir.isMain()) {
+          Add(ctx.out, 30, 30, 4);
+          Add(ctx.out, 30, 30, 4);
         }
+        Jr(ctx.out, 31);
+        break;
+      }
+      default:
+        throw std::runtime_error("unexpected IR operation");
       }
-      pop(5);
     }
   }
 }
 
-void generateCodeProcedures(std::shared_ptr<Treenode> tree,
-                            ProcedureTable &pt) {
-  std::map<std::string, int> offsetTable;
-  int offset = 0;
-  int localVarCount = 0;
-
-  std::shared_ptr<Treenode> procedure = tree;
-  // std::cout << "PROCEDURE LHS: " << procedure->NTrule.lhs << std::endl;
-  if (procedure->NTrule.lhs == "procedure") {
-    // get the name of the procedure to use as a label
-    std::string proclabel = procedure->getChild("ID")->Ttoken.value;
-    if (label_set.count(proclabel)) {
-      // functionlabel_map
-      std::string customlabel = generateLabel();
-      label_set.insert(customlabel);
-      functionlabel_map.insert({proclabel, customlabel});
-    } else {
-      label_set.insert(proclabel);
-      functionlabel_map.insert({proclabel, proclabel});
-    }
-    // outputs the label
-    Label(functionlabel_map[proclabel]);
-    // tree we will use to iterate through the procedure params
-    std::shared_ptr<Treenode> params = procedure->getChild("params");
-    if (params->NTrule.rhs.size() == 0) {
-      // if there are no params, offset is set to be 0
-      offset = 0;
-    } else {
-      // paramlist dcl
-      // paramlist dcl COMMA paramlist
-      std::vector<std::string> paramlist;
-      params = params->getChild("paramlist");
-      // loops through and gets all the variable names
-      // also adds to the offset counter
-      while (params) {
-        std::shared_ptr<Treenode> dcl = params->getChild("dcl");
-        // store the name of the declared variable for later
-        paramlist.push_back(dcl->getChild("ID")->Ttoken.value);
-        offset += 4;
-        params = params->getChild("paramlist");
-      }
-      // pushes the variables and offset to the offset table
-      for (auto it : paramlist) {
-        offsetTable.insert(std::make_pair(it, offset));
-        offset -= 4;
-        // we dont add 1 to localVarCount since we won't pop these
-      }
-      // offset should be 0 at this point
-      // we don't push anything to stack since we assume the caller does that
-
-      // debug print for parameters
-      // for (auto it : paramlist) {
-      //   std::cout << it << ": " << offsetTable[it] << std::endl;
-      // }
-    }
-
-    // set value of frame pointer - offset table now has params
-    // at this points, $29 + 8 is param 1 and $29 + 4 is param 2
-    Subtract(29, 30, 4);
+void generateCodeProcedures(Treenode tree, CodeContext &ctx) {
+  IrProcedure ir = lowerProcedure(tree, ctx.pt, ctx.procedure);
+  if (ctx.emitIr) {
+    std::ostringstream text;
+    printIr(ir, ctx.pt, text);
+    ctx.out.write(text.str());
   } else {
-    // generate label for main
-    Label("main");
-    // set offset to 8 for wain
-    offset = 8;
-    // collects param and declaration nodes from main
-    std::shared_ptr<Treenode> param1 = procedure->getChild("dcl");
-    std::shared_ptr<Treenode> param2 = procedure->getChild("dcl", 2);
-
-    // runs init if first param of main is of type int*
-    if (param1->type == "int*") {
-      push(31);
-      Lis(31);
-      Word("init");
-      Jalr(31);
-      pop(31);
-    } else {
-      push(2);
-      Lis(2);
-      Word(0);
-      push(31);
-      Lis(31);
-      Word("init");
-      Jalr(31);
-      pop(31);
-      pop(2);
-    }
-
-    // add param1 of wain to offsetTable
-    offsetTable.insert(
-        std::make_pair(param1->getChild("ID")->Ttoken.value, offset));
-    offset -= 4;
-    localVarCount++;
-    // generate code to store $1 to stack
-    push(1);
-
-    // add param2 of wain to offsetTable
-    offsetTable.insert(
-        std::make_pair(param2->getChild("ID")->Ttoken.value, offset));
-    offset -= 4;
-    localVarCount++;
-    // generate code to store $2 to stack
-    push(2);
-
-    // set value of frame pointer - offset table now has params
-    // at this points, $29 + 8 is param 1 and $29 + 4 is param 2
-    Subtract(29, 30, 4);
+    selectInstructions(ir, ctx);
   }
+}
 
-  // now we do the dcls stuff :sob:
-  std::shared_ptr<Treenode> dcls = procedure->getChild("dcls");
-  std::vector<std::pair<std::string, int>> declarations;
-
-  while (dcls) {
-    std::shared_ptr<Treenode> dcl = dcls->getChild("dcl");
-    std::shared_ptr<Treenode> becomesNum = dcls->getChild("NUM");
-    std::shared_ptr<Treenode> becomesNull = dcls->getChild("NULL");
-    if (dcl && becomesNum) {
-      // gets the ID of the variable and the value it is assigned
-      declarations.push_back(
-          std::make_pair(dcl->getChild("ID")->Ttoken.value,
-                         std::stoi(becomesNum->Ttoken.value)));
-    } else if (dcl && becomesNull) {
-      // gets the ID of the variable and gives it the value 1
-      declarations.push_back(
-          std::make_pair(dcl->getChild("ID")->Ttoken.value, 1));
-    }
-    dcls = dcls->getChild("dcls");
-  }
-
-  // // print out the declarations stack for debugging
-  // std::cout << "declarations:\n";
-  // while (!declarations.empty()) {
-  //   std::cout << declarations.back().first << " = ";
-  //   std::cout << declarations.back().second << "\n";
-  //   declarations.pop_back();
-  // }
-
-  // push the variables acquired to the offset table
-  // generate code for them as well
-  while (!declarations.empty()) {
-    std::pair<std::string, int> var = declarations.back();
-    declarations.pop_back();
-    offsetTable.insert(std::make_pair(var.first, offset));
-    offset -= 4;
-    localVarCount++;
-    Lis(3);
-    Word(var.second);
-    push(3);
-  }
-
-  // // prints the offset table (not in order) for debugging
-  // std::cout << "Current offsetTable:\n";
-  // for (auto it : offsetTable) {
-  //   std::cout << it.first << " " << it.second << "\n";
-  // }
-
-  // generate code for statements
-  generateCodeOther(procedure->getChild("statements"), pt, offsetTable);
-
-  // wain->debugPrint();
-  // generate code for the return function
-  generateCodeOther(procedure->getChild("expr"), pt, offsetTable);
-
-  for (int i = 0; i < localVarCount; i++) {
-    pop();
+void generateProcedureCode(ProcedureCode &code, const ProcedureTable &pt,
+                           int procedure, bool emitIr) {
+  Emitter buffer;
+  CodeContext ctx{buffer, pt, procedure};
+  ctx.emitIr = emitIr;
+  try {
+    generateCodeProcedures(code.procedure, ctx);
+  } catch (std::runtime_error &err) {
+    code.failed = true;
+    code.error = err.what();
   }
-
-  // end procedure
-  Jr(31);
+  code.text = buffer.take();
 }
 
-int generateCode(std::vector<Token> testVecToken) {
+int generateCode(TokenStream &tokens, std::ostream &out,
+                 std::ostream &diagnostics,
+                 const wlp4::CompileOptions &options) {
   /*
    * Code Generation Pipeline:
-   * 1. Initialize context-free grammar rules from WLP4 specification
-   * 2. Construct SLR(1) DFA for parsing using transition/reduction tables
-   * 3. Convert input tokens into parse-ready format
+   * 1. Drive the SLR(1) parse with the compile-time WLP4_PARSE_TABLE
+   * 2. Pull tokens from the stream one lookahead at a time while parsing
+   * 3. Build the flattened parse tree in post-order from the reductions
    */
-  std::vector<Rule> CFG = getRules(WLP4_CFG);
-  SLR1DFA dfa = buildDFA(WLP4_TRANSITIONS, WLP4_REDUCTIONS);
-  std::deque<Token> tokens = convertInput(testVecToken);
+  ParseTree parseTree;
+  SemanticAnalyzer analyzer;
 
-  // create stacks for both trees and states
-  std::vector<std::shared_ptr<Treenode>> treeStack;
+  // create stacks for both trees (node ids) and states
+  std::vector<std::uint32_t> treeStack;
   std::vector<int> stateStack;
   // populate stateStack with the element 0
   stateStack.push_back(0);
 
   // try catch loop to detect runtime errors from shift
   try {
-    // while the input token vector is not empty
-    while (tokens.size() != 0) {
+    // the stream starts with BOF; parsing ends once EOF has been shifted
+    Token topToken = tokens.next();
+    while (true) {
       // keep repeating until no longer in reduction state
       while (true) {
-        // grab current state and input token at top of stack
-        int currState = stateStack.back();
-        Token topToken = tokens.front();
-
-        // set up key with current state and the type of topToken
-        std::pair<int, std::string> key =
-            std::make_pair(currState, topToken.type);
-        if (dfa.reductions.find(key) != dfa.reductions.end()) {
-          Rule r = CFG[dfa.reductions[key]];
-          reduceTrees(treeStack, r);
-          reduceStates(stateStack, r, dfa);
+        // look up the action for the current state and the lookahead
+        ParseAction action =
+            WLP4_PARSE_TABLE.action(stateStack.back(), topToken.kind);
+        if (isReduce(action)) {
+          int rule = actionRule(action);
+          reduceTrees(treeStack, rule, parseTree);
+          reduceStates(stateStack, rule);
+          analyzer.reduced(Treenode{&parseTree, treeStack.back()});
         } else {
           break;
         }
       }
-      shift(tokens, treeStack, stateStack, dfa);
+      analyzer.shifted(topToken);
+      shift(topToken, treeStack, stateStack, parseTree);
+      if (topToken.kind == TK_EOF) {
+        break;
+      }
+      topToken = tokens.next();
     }
+  } catch (ScanError &err) {
+    diagnostics << "ERROR: " << err.what() << '\n';
+    return 1;
   } catch (std::runtime_error &err) {
-    std::cerr << "ERROR in setup: " << err.what() << '\n';
+    // the rest of the input has not been scanned yet; a lexical error
+    // anywhere in it is reported in preference to the syntax error
+    try {
+      while (tokens.next().kind != TK_EOF) {
+      }
+    } catch (ScanError &scanErr) {
+      diagnostics << "ERROR: " << scanErr.what() << '\n';
+      return 1;
+    }
+    diagnostics << "ERROR in setup: " << err.what() << '\n';
     return 1;
   }
 
-  ProcedureTable pt;
-
-  // this part reduces the tree and collects all the procedures in the tree
-  // checking for errors in syntax while doing so
-  try {
-    reduceTrees(treeStack, CFG[0]);
-    collectProcedures(treeStack[0]->getChild("procedures"), pt);
-    // treeStack[0]->debugPrint();
-  } catch (std::runtime_error &err) {
-    std::cerr << "ERROR in processing: " << err.what() << '\n';
+  reduceTrees(treeStack, 0, parseTree);
+  Treenode root{&parseTree, treeStack.back()};
+  if (options.printStats) {
+    diagnostics << "parse tree: " << parseTree.size() << " nodes, "
+                << parseTree.bytesUsed() << " bytes ("
+                << parseTree.bytesUsed() / double(parseTree.size())
+                << " bytes/node)\n";
+  }
+  // declarations, types and statements were checked as the tree was built
+  if (analyzer.failed) {
+    diagnostics << "ERROR in processing: " << analyzer.error << '\n';
     return 1;
   }
+  Emitter emitter{&out};
+  CodeContext ctx{emitter, analyzer.pt};
+  ctx.emitIr = options.emitIr;
 
   // code generation
   try {
-    // treeStack[0]->debugPrint();
-    std::cout << ".import print\n.import init\n.import new\n.import delete\n";
-    // sets up $4 to hold the value 4
-    Lis(4);
-    Word(4);
-    // jump to main
-    Beq(0, 0, "main");
-    // set a variable procedures to modify as we iterate through the tree
-    std::shared_ptr<Treenode> procedures = treeStack[0]->getChild("procedures");
-    // iterates through the tree to find any procedure nodes and main nodes
-    // calls generateCodeProcedures on the nodes it finds
-    while (procedures) {
-      std::shared_ptr<Treenode> procedure =
-          procedures->getChild("procedure") ? procedures->getChild("procedure")
-                                            : procedures->getChild("main");
-      // procedure->debugPrint();
-      generateCodeProcedures(procedure, pt);
-      procedures = procedures->getChild("procedures");
+    if (!options.emitIr) {
+      emitter.write(
+          ".import print\n.import init\n.import new\n.import delete\n");
+      // sets up $4 to hold the value 4
+      Lis(ctx.out, 4);
+      Word(ctx.out, 4);
+      // jump to main
+      Beq(ctx.out, 0, 0, "main");
+    }
+    // start BOF procedures EOF, where procedures is a chain of
+    // procedure procedures ending in main
+    std::vector<ProcedureCode> codes;
+    for (Treenode procedures = root.child(1);;
+         procedures = procedures.child(1)) {
+      codes.push_back(ProcedureCode{procedures.child(0)});
+      if (procedures.production() != RULE_PROCEDURES_PROCEDURE) {
+        break;
+      }
+    }
+    unsigned threads = options.threads == 0
+                           ? std::max(1u, std::thread::hardware_concurrency())
+                           : options.threads;
+    threads = std::min<std::size_t>(threads, codes.size());
+
+    if (threads == 1) {
+      for (std::size_t i = 0; i < codes.size(); ++i) {
+        ctx.procedure = i;
+        ctx.labelCount = 0;
+        generateCodeProcedures(codes[i].procedure, ctx);
+      }
+    } else {
+      // bodies only read the tree and the procedure table, so each worker
+      // takes the next procedure until none are left
+      std::atomic<std::size_t> next{0};
+      std::vector<std::thread> workers;
+      for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+          for (std::size_t i = next++; i < codes.size(); i = next++) {
+            generateProcedureCode(codes[i], ctx.pt, i, ctx.emitIr);
+          }
+        });
+      }
+      for (std::thread &worker : workers) {
+        worker.join();
+      }
+      // code emitted before a failure is written before the error is
+      // reported, as in serial order
+      for (ProcedureCode &code : codes) {
+        emitter.write(code.text);
+        if (code.failed) {
+          throw std::runtime_error(code.error);
+        }
+        code.text = std::string{};
+      }
     }
   } catch (std::runtime_error &err) {
-    std::cerr << "ERROR in code generation: " << err.what() << '\n';
+    diagnostics << "ERROR in code generation: " << err.what() << '\n';
     return 1;
   }
   return 0;
@@ -1,41 +1,52 @@
 #ifndef CODEGEN_H
 #define CODEGEN_H
 
+#include "ir.h"
+#include "libwlp4.h"
 #include "structures.h"
 
 // Parses input string into vector of grammar rules
-std::vector<Rule> getRules(std::string input);
+std::vector<Rule> getRules(std::string_view input);
 
-// Constructs SLR(1) DFA from transition and reduction tables
-SLR1DFA buildDFA(std::string transitions, std::string reductions);
-
-// Converts input stream to token deque
-std::deque<Token> convertInput(std::istream &in);
-
-// Converts token vector to token deque
-std::deque<Token> convertInput(std::vector<Token> &tokVec);
+// The WLP4 grammar, indexed by rule number
+const std::vector<Rule> &grammarRules();
 
 // Reduces parse trees according to grammar rule
-void reduceTrees(std::vector<std::shared_ptr<Treenode>> &trees, const Rule r);
-
-// Reduces parser states according to DFA and grammar rule  
-void reduceStates(std::vector<int> &states, const Rule r, SLR1DFA &dfa);
-
-// Shifts next token and updates parser state
-void shift(std::deque<Token> &tokens,
-           std::vector<std::shared_ptr<Treenode>> &trees,
-           std::vector<int> &states, SLR1DFA &dfa);
-std::vector<std::shared_ptr<Treenode>>
-getDeclarations(std::shared_ptr<Treenode> tree);
-std::vector<std::string> getArgTypes(std::shared_ptr<Treenode> tree);
-void collectProcedures(std::shared_ptr<Treenode> tree, ProcedureTable &pt);
-void checkStatementsAndTests(std::shared_ptr<Treenode> tree);
-std::shared_ptr<Treenode> getNode(std::shared_ptr<Treenode>, std::string type);
-std::string generateLabel(int number);
+void reduceTrees(std::vector<std::uint32_t> &trees, int rule,
+                 ParseTree &tree);
+
+// Pops the states of rule's right-hand side and pushes the goto state
+void reduceStates(std::vector<int> &states, int rule);
+
+// Shifts the lookahead token and updates parser state
+void shift(const Token &topToken, std::vector<std::uint32_t> &trees,
+           std::vector<int> &states, ParseTree &tree);
+Signature getArgTypes(Treenode tree);
+// Types node from its already typed children, looking names up in pt and vt
+void annotateType(Treenode node, const ProcedureTable &pt,
+                  const VariableTable &vt);
+// Checks the typing rules of a statement or test node
+void checkStatementOrTest(Treenode tree);
+// New label for the procedure being generated
+std::string generateLabel(CodeContext &ctx);
+// Entry label of user procedure name
+std::string procedureLabel(std::string_view name);
 void generateCodePrintln();
-void generateCodeOther(std::shared_ptr<Treenode> tree, ProcedureTable &pt,
-                       std::map<std::string, int> offsetTable);
-void generateCodeProcedures(std::shared_ptr<Treenode> tree, ProcedureTable &pt);
-int generateCode(std::vector<Token> testVecToken);
+// Emits MIPS for the IR of a procedure
+void selectInstructions(const IrProcedure &ir, CodeContext &ctx);
+// Lowers a procedure to IR, then writes its MIPS (or the IR itself)
+void generateCodeProcedures(Treenode tree, CodeContext &ctx);
+// Generates the procedure-th procedure of the program into code.text
+void generateProcedureCode(ProcedureCode &code, const ProcedureTable &pt,
+                           int procedure, bool emitIr);
+
+// Parses the token stream and writes the generated code (or with emitIr,
+// the IR) to out, and errors to diagnostics; with printStats, also reports
+// the parse tree size there. Procedure bodies are generated on
+// options.threads workers (0 for one per hardware thread) and the output
+// does not depend on the count.
+int generateCode(TokenStream &tokens, std::ostream &out,
+                 std::ostream &diagnostics,
+                 const wlp4::CompileOptions &options);
 
 #endif // CODEGEN_H
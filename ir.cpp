@@ -0,0 +1,433 @@
+#include "ir.h"
+#include "cfg.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Builds the IR of one procedure, block by block in layout order
+struct Lowering {
+  IrProcedure &ir;
+  const VariableTable &vars;
+
+  int variable(Treenode id) const {
+    return vars.slots.find(id.token().id)->second;
+  }
+
+  std::int32_t temporary() { return ir.vregs++; }
+
+  std::int32_t emit(IrOp op, std::int32_t dst, std::int32_t a = NO_VREG,
+                    std::int32_t b = NO_VREG, std::int32_t imm = 0) {
+    ir.code.push_back(IrInstr{op, dst, a, b, imm});
+    return dst;
+  }
+
+  // Ends the current block with terminator op and starts the next one;
+  // returns the index of the ended block
+  int endBlock(IrOp op, std::int32_t a = NO_VREG) {
+    emit(op, NO_VREG, a);
+    int block = ir.blocks.size() - 1;
+    ir.blocks.back().end = ir.code.size();
+    ir.blocks.push_back(IrBlock{std::uint32_t(ir.code.size())});
+    return block;
+  }
+
+  int currentBlock() const { return ir.blocks.size() - 1; }
+
+  // Stores value into variable, renaming the temporary that computed it
+  // when it was the last thing emitted
+  void assign(int var, std::int32_t value) {
+    if (ir.inMemory[var]) {
+      emit(IR_STORE_VAR, NO_VREG, value, NO_VREG, var);
+    } else if (ir.isTemporary(value) &&
+               ir.code.size() > ir.blocks.back().begin &&
+               ir.code.back().dst == value) {
+      ir.code.back().dst = var;
+    } else {
+      emit(IR_COPY, var, value);
+    }
+  }
+
+  std::int32_t expr(Treenode tree);
+  std::int32_t term(Treenode tree);
+  std::int32_t factor(Treenode tree);
+  std::int32_t test(Treenode tree);
+  void statement(Treenode tree);
+  void statements(Treenode tree);
+};
+
+std::int32_t Lowering::expr(Treenode tree) {
+  // expr expr PLUS|MINUS term is left-recursive; walk down the chain first,
+  // then combine the terms innermost first
+  std::vector<Treenode> chain;
+  Treenode node = tree;
+  while (node.production() != RULE_EXPR_TERM) {
+    chain.push_back(node);
+    node = node.child(0);
+  }
+  std::int32_t left = term(node.child(0));
+  while (!chain.empty()) {
+    Treenode expression = chain.back().child(0);
+    Treenode right = chain.back().child(2);
+    IrOp op = chain.back().production() == RULE_EXPR_PLUS ? IR_ADD : IR_SUB;
+    chain.pop_back();
+    std::int32_t value = term(right);
+    ValueType leftType = expression.type();
+    ValueType rightType = right.type();
+    // pointer arithmetic is in words
+    if (leftType == TYPE_INT_PTR && rightType == TYPE_INT) {
+      value = emit(IR_SCALE, temporary(), value);
+    } else if (leftType == TYPE_INT && rightType == TYPE_INT_PTR) {
+      left = emit(IR_SCALE, temporary(), left);
+    } else if (leftType == TYPE_INT_PTR && rightType == TYPE_INT_PTR) {
+      if (op == IR_ADD) {
+        throw std::runtime_error("cannot add two int*'s");
+      }
+      left = emit(IR_SUB, temporary(), left, value);
+      left = emit(IR_UNSCALE, temporary(), left);
+      continue;
+    }
+    left = emit(op, temporary(), left, value);
+  }
+  return left;
+}
+
+std::int32_t Lowering::term(Treenode tree) {
+  // term term STAR|SLASH|PCT factor is left-recursive like expr
+  std::vector<Treenode> chain;
+  Treenode node = tree;
+  while (node.production() != RULE_TERM_FACTOR) {
+    chain.push_back(node);
+    node = node.child(0);
+  }
+  std::int32_t left = factor(node.child(0));
+  while (!chain.empty()) {
+    Treenode right = chain.back().child(2);
+    int production = chain.back().production();
+    chain.pop_back();
+    std::int32_t value = factor(right);
+    IrOp op = production == RULE_TERM_STAR    ? IR_MUL
+              : production == RULE_TERM_SLASH ? IR_DIV
+                                              : IR_REM;
+    left = emit(op, temporary(), left, value);
+  }
+  return left;
+}
+
+std::int32_t Lowering::factor(Treenode tree) {
+  switch (tree.production()) {
+  case RULE_FACTOR_ID: {
+    int var = variable(tree.child(0));
+    if (ir.inMemory[var]) {
+      return emit(IR_LOAD_VAR, temporary(), NO_VREG, NO_VREG, var);
+    }
+    return var;
+  }
+  case RULE_FACTOR_NUM:
+    return emit(IR_CONST, temporary(), NO_VREG, NO_VREG,
+                std::stoi(std::string(tree.child(0).token().value)));
+  case RULE_FACTOR_NULL:
+    // NULL is the (never valid, odd) address 1
+    return emit(IR_CONST, temporary(), NO_VREG, NO_VREG, 1);
+  case RULE_FACTOR_PAREN:
+    return expr(tree.child(1));
+  case RULE_FACTOR_AMP: {
+    // factor AMP lvalue
+    Treenode lvalue = tree.child(1);
+    while (lvalue.production() == RULE_LVALUE_PAREN) {
+      lvalue = lvalue.child(1);
+    }
+    if (lvalue.production() == RULE_LVALUE_ID) {
+      return emit(IR_ADDR_VAR, temporary(), NO_VREG, NO_VREG,
+                  variable(lvalue.child(0)));
+    }
+    // &*e is e
+    return factor(lvalue.child(1));
+  }
+  case RULE_FACTOR_STAR: {
+    std::int32_t address = factor(tree.child(1));
+    return emit(IR_LOAD, temporary(), address);
+  }
+  case RULE_FACTOR_NEW: {
+    // factor NEW INT LBRACK expr RBRACK
+    std::int32_t size = expr(tree.child(3));
+    return emit(IR_NEW, temporary(), size);
+  }
+  case RULE_FACTOR_CALL:
+  case RULE_FACTOR_CALL_ARGS: {
+    // the arguments are evaluated left to right before the call
+    std::vector<std::int32_t> values;
+    if (tree.production() == RULE_FACTOR_CALL_ARGS) {
+      for (Treenode arglist = tree.child(2);; arglist = arglist.child(2)) {
+        values.push_back(expr(arglist.child(0)));
+        if (arglist.production() != RULE_ARGLIST_COMMA) {
+          break;
+        }
+      }
+    }
+    std::int32_t first = ir.args.size();
+    ir.args.insert(ir.args.end(), values.begin(), values.end());
+    return emit(IR_CALL, temporary(), first, values.size(),
+                tree.child(0).token().id);
+  }
+  default:
+    throw std::runtime_error("unexpected factor");
+  }
+}
+
+std::int32_t Lowering::test(Treenode tree) {
+  // test expr OP expr; pointers compare unsigned
+  std::int32_t left = expr(tree.child(0));
+  std::int32_t right = expr(tree.child(2));
+  IrOp less = tree.child(0).type() == TYPE_INT ? IR_LT : IR_LTU;
+  switch (tree.production()) {
+  case RULE_TEST_EQ:
+    return emit(IR_EQ, temporary(), left, right);
+  case RULE_TEST_NE:
+    return emit(IR_NE, temporary(), left, right);
+  case RULE_TEST_LT:
+    return emit(less, temporary(), left, right);
+  case RULE_TEST_GT:
+    return emit(less, temporary(), right, left);
+  case RULE_TEST_LE: {
+    std::int32_t greater = emit(less, temporary(), right, left);
+    return emit(IR_NOT, temporary(), greater);
+  }
+  default: {
+    std::int32_t lesser = emit(less, temporary(), left, right);
+    return emit(IR_NOT, temporary(), lesser);
+  }
+  }
+}
+
+void Lowering::statements(Treenode tree) {
+  // statements statements statement is left-recursive: collect the
+  // statements from the chain (last first), then lower them in order
+  std::vector<Treenode> list;
+  for (Treenode node = tree; node.production() == RULE_STATEMENTS;
+       node = node.child(0)) {
+    list.push_back(node.child(1));
+  }
+  for (auto it = list.rbegin(); it != list.rend(); ++it) {
+    statement(*it);
+  }
+}
+
+void Lowering::statement(Treenode tree) {
+  switch (tree.production()) {
+  case RULE_STATEMENT_ASSIGN: {
+    // statement lvalue BECOMES expr SEMI
+    Treenode lvalue = tree.child(0);
+    while (lvalue.production() == RULE_LVALUE_PAREN) {
+      lvalue = lvalue.child(1);
+    }
+    if (lvalue.production() == RULE_LVALUE_ID) {
+      int var = variable(lvalue.child(0));
+      assign(var, expr(tree.child(2)));
+    } else {
+      // the address is evaluated before the value
+      std::int32_t address = factor(lvalue.child(1));
+      emit(IR_STORE, NO_VREG, address, expr(tree.child(2)));
+    }
+    break;
+  }
+  case RULE_STATEMENT_PRINTLN:
+    // statement PRINTLN LPAREN expr RPAREN SEMI
+    emit(IR_PRINT, NO_VREG, expr(tree.child(2)));
+    break;
+  case RULE_STATEMENT_DELETE:
+    // statement DELETE LBRACK RBRACK expr SEMI
+    emit(IR_DELETE, NO_VREG, expr(tree.child(3)));
+    break;
+  case RULE_STATEMENT_WHILE: {
+    // statement WHILE LPAREN test RPAREN LBRACE statements RBRACE
+    int before = endBlock(IR_JUMP);
+    int head = currentBlock();
+    ir.blocks[before].successors[0] = head;
+    int check = endBlock(IR_BRANCH, test(tree.child(2)));
+    ir.blocks[check].successors[0] = currentBlock();
+    statements(tree.child(5));
+    int body = endBlock(IR_JUMP);
+    ir.blocks[body].successors[0] = head;
+    ir.blocks[check].successors[1] = currentBlock();
+    break;
+  }
+  case RULE_STATEMENT_IF: {
+    // statement
+    // IF LPAREN test RPAREN LBRACE statements RBRACE
+    // ELSE LBRACE statements RBRACE
+    int check = endBlock(IR_BRANCH, test(tree.child(2)));
+    ir.blocks[check].successors[0] = currentBlock();
+    statements(tree.child(5));
+    int thenEnd = endBlock(IR_JUMP);
+    ir.blocks[check].successors[1] = currentBlock();
+    statements(tree.child(9));
+    int elseEnd = endBlock(IR_JUMP);
+    ir.blocks[thenEnd].successors[0] = currentBlock();
+    ir.blocks[elseEnd].successors[0] = currentBlock();
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+} // namespace
+
+IrProcedure lowerProcedure(Treenode procedure, const ProcedureTable &pt,
+                           int index) {
+  const Procedure &declared = pt.procedures[index];
+  IrProcedure ir;
+  ir.procedure = procedure;
+  ir.index = index;
+  ir.params = declared.signature.size();
+  ir.variables = declared.symbolTable.variables.size();
+  ir.vregs = ir.variables;
+  ir.inMemory.assign(ir.variables, false);
+  ir.blocks.push_back(IrBlock{});
+
+  Lowering lower{ir, declared.symbolTable};
+  // a variable whose address is taken anywhere in the procedure lives in
+  // the frame; the subtree of the procedure is a contiguous range of nodes
+  ParseTree &tree = *procedure.tree;
+  for (std::uint32_t id = tree.subtreeBegin(procedure.id); id < procedure.id;
+       ++id) {
+    if (tree.rule[id] != RULE_FACTOR_AMP) {
+      continue;
+    }
+    Treenode lvalue = Treenode{&tree, id}.child(1);
+    while (lvalue.production() == RULE_LVALUE_PAREN) {
+      lvalue = lvalue.child(1);
+    }
+    if (lvalue.production() == RULE_LVALUE_ID) {
+      ir.inMemory[lower.variable(lvalue.child(0))] = true;
+    }
+  }
+
+  bool isMain = ir.isMain();
+  // dcls dcls dcl BECOMES NUM|NULL SEMI is left-recursive; the locals are
+  // initialized in declaration order
+  std::vector<Treenode> dcls;
+  for (Treenode node = procedure.child(isMain ? 8 : 6);
+       node.production() != RULE_DCLS_EMPTY; node = node.child(0)) {
+    dcls.push_back(node);
+  }
+  for (auto it = dcls.rbegin(); it != dcls.rend(); ++it) {
+    // NULL is given the value 1
+    int value = it->production() == RULE_DCLS_NUM
+                    ? std::stoi(std::string(it->child(3).token().value))
+                    : 1;
+    std::int32_t constant =
+        lower.emit(IR_CONST, lower.temporary(), NO_VREG, NO_VREG, value);
+    lower.assign(lower.variable(it->child(1).child(1)), constant);
+  }
+
+  lower.statements(procedure.child(isMain ? 9 : 7));
+  lower.endBlock(IR_RET, lower.expr(procedure.child(isMain ? 11 : 9)));
+  // endBlock opened a block after the return; it is empty
+  ir.blocks.pop_back();
+  return ir;
+}
+
+void printIr(const IrProcedure &ir, const ProcedureTable &pt,
+             std::ostream &out) {
+  const Procedure &declared = pt.procedures[ir.index];
+  const VariableTable &vars = declared.symbolTable;
+  auto vreg = [&](std::int32_t v) -> std::ostream & {
+    if (ir.isTemporary(v)) {
+      return out << 't' << v - ir.variables;
+    }
+    return out << vars.variables[v].name;
+  };
+
+  out << (ir.isMain() ? std::string_view{"wain"} : declared.name) << '(';
+  for (int i = 0; i < ir.params; ++i) {
+    out << (i ? ", " : "") << vars.variables[i].name;
+  }
+  out << ")";
+  for (int i = ir.params; i < ir.variables; ++i) {
+    out << (i == ir.params ? " locals " : ", ") << vars.variables[i].name;
+  }
+  for (int i = 0; i < ir.variables; ++i) {
+    if (ir.inMemory[i]) {
+      out << " [" << vars.variables[i].name << " in frame]";
+    }
+  }
+  out << '\n';
+
+  const ControlFlowGraph &cfg = controlFlow(ir);
+  const DominatorTree &dom = dominators(ir);
+  const Liveness &live = liveness(ir);
+  for (std::size_t b = 0; b < ir.blocks.size(); ++b) {
+    const IrBlock &block = ir.blocks[b];
+    out << "B" << b << ":";
+    // predecessors, immediate dominator and live-in variables
+    for (std::uint32_t i = cfg.predecessorBegin[b];
+         i < cfg.predecessorBegin[b + 1]; ++i) {
+      out << (i == cfg.predecessorBegin[b] ? "  ; preds B" : ", B")
+          << cfg.predecessors[i];
+    }
+    if (b > 0 && dom.idom[b] >= 0) {
+      out << "  ; idom B" << dom.idom[b];
+    }
+    bool first = true;
+    for (int v = 0; v < ir.variables; ++v) {
+      if (Liveness::contains(live.in(b), v)) {
+        out << (first ? "  ; live " : ", ") << vars.variables[v].name;
+        first = false;
+      }
+    }
+    out << '\n';
+    for (std::uint32_t i = block.begin; i < block.end; ++i) {
+      const IrInstr &instr = ir.code[i];
+      out << "  ";
+      if (instr.dst != NO_VREG) {
+        vreg(instr.dst) << " = ";
+      }
+      out << IR_OP_NAMES[instr.op];
+      switch (instr.op) {
+      case IR_CONST:
+        out << ' ' << instr.imm;
+        break;
+      case IR_LOAD_VAR:
+      case IR_ADDR_VAR:
+        out << ' ' << vars.variables[instr.imm].name;
+        break;
+      case IR_STORE_VAR:
+        out << ' ' << vars.variables[instr.imm].name << ", ";
+        vreg(instr.a);
+        break;
+      case IR_CALL:
+        out << ' ' << pt.get(instr.imm).name << '(';
+        for (std::int32_t k = 0; k < instr.b; ++k) {
+          if (k) {
+            out << ", ";
+          }
+          vreg(ir.args[instr.a + k]);
+        }
+        out << ')';
+        break;
+      case IR_JUMP:
+        out << " B" << block.successors[0];
+        break;
+      case IR_BRANCH:
+        out << ' ';
+        vreg(instr.a) << ", B" << block.successors[0] << ", B"
+                      << block.successors[1];
+        break;
+      default:
+        if (instr.a != NO_VREG) {
+          out << ' ';
+          vreg(instr.a);
+        }
+        if (instr.b != NO_VREG) {
+          out << ", ";
+          vreg(instr.b);
+        }
+        break;
+      }
+      out << '\n';
+    }
+  }
+}
@@ -0,0 +1,119 @@
+#ifndef IR_H
+#define IR_H
+
+#include "wlp4data.h"
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+// Three-address intermediate representation of one procedure, between the
+// parse tree and MIPS. Values live in virtual registers (vregs). The first
+// vregs are the procedure's variables, numbered as in its symbol table
+// (parameters first); the rest are temporaries, each defined once. Variables
+// whose address is taken are kept in the frame instead and reached through
+// the *_VAR operations.
+enum IrOp : std::uint8_t {
+  IR_CONST,     // dst = imm
+  IR_COPY,      // dst = a
+  IR_ADD,       // dst = a + b
+  IR_SUB,       // dst = a - b
+  IR_MUL,       // dst = a * b
+  IR_DIV,       // dst = a / b
+  IR_REM,       // dst = a % b
+  IR_SCALE,     // dst = a * 4, an int as a pointer offset
+  IR_UNSCALE,   // dst = a / 4, a pointer difference as an int
+  IR_LT,        // dst = a < b (signed)
+  IR_LTU,       // dst = a < b (unsigned, for pointers)
+  IR_EQ,        // dst = a == b
+  IR_NE,        // dst = a != b
+  IR_NOT,       // dst = a == 0
+  IR_LOAD,      // dst = *a
+  IR_STORE,     // *a = b
+  IR_LOAD_VAR,  // dst = variable imm
+  IR_STORE_VAR, // variable imm = a
+  IR_ADDR_VAR,  // dst = &variable imm
+  IR_CALL,      // dst = procedure imm (symbol id) of args[a .. a + b)
+  IR_PRINT,     // println(a)
+  IR_NEW,       // dst = new int[a], NULL if the allocation fails
+  IR_DELETE,    // delete [] a, unless a is NULL
+  IR_JUMP,      // goto successor 0
+  IR_BRANCH,    // goto successor 0 if a != 0, else successor 1
+  IR_RET,       // return a
+  IR_OP_COUNT
+};
+
+constexpr const char *IR_OP_NAMES[IR_OP_COUNT] = {
+    "const",   "copy",    "add",    "sub",    "mul",    "div",     "rem",
+    "scale",   "unscale", "lt",     "ltu",    "eq",     "ne",      "not",
+    "load",    "store",   "loadvar", "storevar", "addrvar", "call", "print",
+    "new",     "delete",  "jump",   "branch", "ret"};
+
+// vreg fields that are not used hold NO_VREG
+constexpr std::int32_t NO_VREG = -1;
+
+struct IrInstr {
+  IrOp op;
+  std::int32_t dst = NO_VREG;
+  std::int32_t a = NO_VREG;
+  std::int32_t b = NO_VREG;
+  std::int32_t imm = 0;
+};
+
+// A basic block: code[begin, end) of its procedure, ending in a JUMP,
+// BRANCH or RET whose targets are the block's successors
+struct IrBlock {
+  std::uint32_t begin = 0;
+  std::uint32_t end = 0;
+  std::int32_t successors[2] = {-1, -1};
+};
+
+// Analyses cached with a procedure (see cfg.h)
+struct IrAnalyses;
+
+struct IrProcedure {
+  Treenode procedure;
+  // position of the procedure in the program, main last
+  int index = 0;
+  int params = 0;
+  int variables = 0;
+  int vregs = 0;
+  // per variable: set if its address is taken, so it stays in the frame
+  std::vector<bool> inMemory;
+  // instructions of all blocks, block by block in layout order
+  std::vector<IrInstr> code;
+  std::vector<IrBlock> blocks;
+  // argument vregs of the calls
+  std::vector<std::int32_t> args;
+  mutable std::shared_ptr<IrAnalyses> analyses;
+
+  bool isMain() const { return procedure.production() == RULE_MAIN; }
+  bool isTemporary(std::int32_t vreg) const { return vreg >= variables; }
+};
+
+// Calls f with each vreg instr reads
+template <typename F>
+void forEachUse(const IrProcedure &ir, const IrInstr &instr, F f) {
+  if (instr.op == IR_CALL) {
+    for (std::int32_t k = 0; k < instr.b; ++k) {
+      f(ir.args[instr.a + k]);
+    }
+    return;
+  }
+  if (instr.a != NO_VREG) {
+    f(instr.a);
+  }
+  if (instr.b != NO_VREG) {
+    f(instr.b);
+  }
+}
+
+// Lowers the index-th procedure of the program (declared in pt) to IR
+IrProcedure lowerProcedure(Treenode procedure, const ProcedureTable &pt,
+                           int index);
+
+// Writes ir in a readable form, for --emit=ir
+void printIr(const IrProcedure &ir, const ProcedureTable &pt,
+             std::ostream &out);
+
+#endif // IR_H
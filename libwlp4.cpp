@@ -0,0 +1,47 @@
+#include "libwlp4.h"
+#include "codegen.h"
+#include "scanner.h"
+#include <iostream>
+#include <sstream>
+
+namespace wlp4 {
+
+int compile(std::string_view source, std::ostream &out,
+            std::ostream &diagnostics, const CompileOptions &options) {
+  InternTable names;
+
+  // large sources are tokenized up front on several threads; otherwise the
+  // parser pulls tokens straight from the scanner
+  if (options.printTokens || source.length() >= PARALLEL_SCAN_MIN_BYTES) {
+    std::vector<Token> testVecToken;
+    if (scan(source, testVecToken, names, diagnostics) != 0) {
+      return 1;
+    }
+
+    if (options.printTokens) {
+      out << "Tokenized:" << std::endl;
+      for (auto t : testVecToken) {
+        out << t.typeName() << " " << (t.value == "\n" ? "" : t.value)
+            << std::endl;
+      }
+    }
+
+    TokenVectorStream tokens{testVecToken};
+    return generateCode(tokens, out, diagnostics, options);
+  }
+  Scanner tokens{source, names};
+  return generateCode(tokens, out, diagnostics, options);
+}
+
+CompileResult compile(std::string_view source,
+                      const CompileOptions &options) {
+  std::ostringstream out;
+  std::ostringstream diagnostics;
+  CompileResult result;
+  result.status = compile(source, out, diagnostics, options);
+  result.assembly = out.str();
+  result.diagnostics = diagnostics.str();
+  return result;
+}
+
+} // namespace wlp4
@@ -0,0 +1,44 @@
+#ifndef LIBWLP4_H
+#define LIBWLP4_H
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+// The compiler as a library. Every call keeps its state (tokens, parse tree,
+// symbol tables, labels) to itself, so any number of compilations may run at
+// once on different threads.
+
+namespace wlp4 {
+
+struct CompileOptions {
+  // write the scanned token list before the generated code
+  bool printTokens = false;
+  // report the size of the parse tree with the diagnostics
+  bool printStats = false;
+  // code generation threads; 0 uses one per hardware thread. The default is
+  // one until a speedup from more has been measured.
+  unsigned threads = 1;
+  // write the intermediate representation instead of MIPS
+  bool emitIr = false;
+};
+
+struct CompileResult {
+  // 0 if the program compiled, 1 if it was rejected
+  int status = 0;
+  std::string assembly;
+  std::string diagnostics;
+};
+
+// Compiles WLP4 source to MIPS assembly written to out, reporting errors to
+// diagnostics; returns 0 on success and 1 if the program was rejected
+int compile(std::string_view source, std::ostream &out,
+            std::ostream &diagnostics, const CompileOptions &options = {});
+
+// Compiles WLP4 source to MIPS assembly in memory
+CompileResult compile(std::string_view source,
+                      const CompileOptions &options = {});
+
+} // namespace wlp4
+
+#endif // LIBWLP4_H
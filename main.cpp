@@ -1,16 +1,77 @@
 
-#include "codegen.h"
+#include "libwlp4.h"
 #include "scanner.h"
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
+#include <string_view>
 
-int main() {
-  std::vector<Token> testVecToken;
-  scan(testVecToken);
+constexpr const char *USAGE =
+    "usage: main [--tokens] [--stats] [--threads N] [--emit=ir] [file]\n";
 
-  std::cout << "Tokenized:" << std::endl;
-  for (auto t : testVecToken) {
-    std::cout << t.type << " " << (t.value == "\n" ? "" : t.value) << std::endl;
+// Parses the value of --threads, a count from 0 (one per hardware thread) to
+// 1024
+bool parseThreads(const char *text, unsigned &threads) {
+  char *end = nullptr;
+  errno = 0;
+  unsigned long value = std::strtoul(text, &end, 10);
+  if (*text < '0' || *text > '9' || *end != '\0' || errno != 0 ||
+      value > 1024) {
+    return false;
+  }
+  threads = value;
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  // --tokens prints the scanned token list before the generated code
+  // --stats reports the size of the parse tree on stderr
+  // --threads sets the number of code generation threads (default: 1)
+  // --emit=ir prints the intermediate representation instead of MIPS
+  bool printTokens = false;
+  bool printStats = false;
+  bool emitIr = false;
+  unsigned threads = 1;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--tokens") {
+      printTokens = true;
+    } else if (arg == "--stats") {
+      printStats = true;
+    } else if (arg == "--threads") {
+      if (i + 1 == argc || !parseThreads(argv[++i], threads)) {
+        std::cerr << "ERROR: --threads needs a thread count\n" << USAGE;
+        return 1;
+      }
+    } else if (arg == "--emit=ir") {
+      emitIr = true;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      std::cerr << "ERROR: unknown option " << arg << "\n" << USAGE;
+      return 1;
+    } else if (path) {
+      std::cerr << "ERROR: more than one input file\n" << USAGE;
+      return 1;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  // the program is memory-mapped when a file is named, otherwise it is read
+  // from stdin; tokens point into the buffer so it lives until codegen ends
+  SourceBuffer source;
+  try {
+    source = path ? SourceBuffer::mapFile(path)
+                  : SourceBuffer::readStream(stdin);
+  } catch (std::runtime_error &e) {
+    std::cerr << "ERROR: " << e.what() << "\n";
+    return 1;
   }
 
-  generateCode(testVecToken);
+  wlp4::CompileOptions options;
+  options.printTokens = printTokens;
+  options.printStats = printStats;
+  options.threads = threads;
+  options.emitIr = emitIr;
+  return wlp4::compile(source.text(), std::cout, std::cerr, options);
 }
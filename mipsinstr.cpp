@@ -5,87 +5,210 @@
 // MIPS Assembly Instruction Implementations
 // Each function outputs the corresponding MIPS assembly instruction
 // Register parameters are referenced as $d, $s, $t in the output
-// All instructions are output followed by a newline
-
-// Arithmetic Instructions
-void Add(int d, int s, int t) {
-  std::cout << "add $" << d << ", $" << s << ", $" << t << "\n";
+// All instructions are written to out followed by a newline
+
+void Emitter::flush() {
+  if (sink) {
+    sink->write(block, used);
+  } else {
+    text.append(block, used);
+  }
+  used = 0;
 }
 
-void Subtract(int d, int s, int t) {
-  std::cout << "sub $" << d << ", $" << s << ", $" << t << "\n";
+std::string Emitter::take() {
+  flush();
+  return std::move(text);
 }
 
-void Multiply(int s, int t) {
-  std::cout << "mult $" << s << ", $" << t << "\n";
+void Emitter::drain(const char *data, std::size_t size) {
+  if (sink) {
+    sink->write(data, size);
+  } else {
+    text.append(data, size);
+  }
 }
 
-void MultiplyU(int s, int t) {
-  std::cout << "multu $" << s << ", $" << t << "\n";
+char *formatInt(char *p, int i) {
+  unsigned value = i;
+  if (i < 0) {
+    *p++ = '-';
+    value = 0u - value;
+  }
+  char digits[10];
+  int count = 0;
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  while (count > 0) {
+    *p++ = digits[--count];
+  }
+  return p;
 }
 
-void Divide(int s, int t) { std::cout << "div $" << s << ", $" << t << "\n"; }
+namespace {
 
-void DivideU(int s, int t) { std::cout << "divu $" << s << ", $" << t << "\n"; }
+char *put(char *p, std::string_view s) {
+  std::memcpy(p, s.data(), s.size());
+  return p + s.size();
+}
 
-void Mfhi(int d) { std::cout << "mfhi $" << d << "\n"; }
+// op $d, $s, $t
+void threeRegisters(Emitter &out, std::string_view op, int d, int s, int t) {
+  char *p = out.reserve(Emitter::MAX_LINE);
+  p = put(p, op);
+  p = formatInt(p, d);
+  p = put(p, ", $");
+  p = formatInt(p, s);
+  p = put(p, ", $");
+  p = formatInt(p, t);
+  *p++ = '\n';
+  out.commit(p);
+}
 
-void Mflo(int d) { std::cout << "mflo $" << d << "\n"; }
+// op $s, $t
+void twoRegisters(Emitter &out, std::string_view op, int s, int t) {
+  char *p = out.reserve(Emitter::MAX_LINE);
+  p = put(p, op);
+  p = formatInt(p, s);
+  p = put(p, ", $");
+  p = formatInt(p, t);
+  *p++ = '\n';
+  out.commit(p);
+}
 
-void Lis(int d) { std::cout << "lis $" << d << "\n"; }
+// op $d
+void oneRegister(Emitter &out, std::string_view op, int d) {
+  char *p = out.reserve(Emitter::MAX_LINE);
+  p = put(p, op);
+  p = formatInt(p, d);
+  *p++ = '\n';
+  out.commit(p);
+}
 
-void Slt(int d, int s, int t) {
-  std::cout << "slt $" << d << ", $" << s << ", $" << t << "\n";
+// op $s, $t, i
+void branch(Emitter &out, std::string_view op, int s, int t, int i) {
+  char *p = out.reserve(Emitter::MAX_LINE);
+  p = put(p, op);
+  p = formatInt(p, s);
+  p = put(p, ", $");
+  p = formatInt(p, t);
+  p = put(p, ", ");
+  p = formatInt(p, i);
+  *p++ = '\n';
+  out.commit(p);
 }
 
-void Sltu(int d, int s, int t) {
-  std::cout << "sltu $" << d << ", $" << s << ", $" << t << "\n";
+// op $s, $t, label
+void branch(Emitter &out, std::string_view op, int s, int t,
+            std::string_view label) {
+  char *p = out.reserve(Emitter::MAX_LINE);
+  p = put(p, op);
+  p = formatInt(p, s);
+  p = put(p, ", $");
+  p = formatInt(p, t);
+  p = put(p, ", ");
+  out.commit(p);
+  out.write(label);
+  out.write("\n");
 }
 
-void Jr(int s) { std::cout << "jr $" << s << "\n"; }
+// op $t, i($s)
+void memory(Emitter &out, std::string_view op, int t, int s, int i) {
+  char *p = out.reserve(Emitter::MAX_LINE);
+  p = put(p, op);
+  p = formatInt(p, t);
+  p = put(p, ", ");
+  p = formatInt(p, i);
+  p = put(p, "($");
+  p = formatInt(p, s);
+  p = put(p, ")\n");
+  out.commit(p);
+}
 
-void Jalr(int s) { std::cout << "jalr $" << s << "\n"; }
+} // namespace
 
-void Beq(int s, int t, std::string label) {
-  std::cout << "beq $" << s << ", $" << t << ", " + label + "\n";
+// Arithmetic Instructions
+void Add(Emitter &out, int d, int s, int t) {
+  threeRegisters(out, "add $", d, s, t);
 }
 
-void Bne(int s, int t, std::string label) {
-  std::cout << "bne $" << s << ", $" << t << ", " + label + "\n";
+void Subtract(Emitter &out, int d, int s, int t) {
+  threeRegisters(out, "sub $", d, s, t);
 }
 
-void Beq(int s, int t, int i) {
-  std::cout << "beq $" << s << ", $" << t << ", " << i << "\n";
+void Multiply(Emitter &out, int s, int t) { twoRegisters(out, "mult $", s, t); }
+
+void MultiplyU(Emitter &out, int s, int t) {
+  twoRegisters(out, "multu $", s, t);
 }
 
-void Bne(int s, int t, int i) {
-  std::cout << "bne $" << s << ", $" << t << ", " << i << "\n";
+void Divide(Emitter &out, int s, int t) { twoRegisters(out, "div $", s, t); }
+
+void DivideU(Emitter &out, int s, int t) { twoRegisters(out, "divu $", s, t); }
+
+void Mfhi(Emitter &out, int d) { oneRegister(out, "mfhi $", d); }
+
+void Mflo(Emitter &out, int d) { oneRegister(out, "mflo $", d); }
+
+void Lis(Emitter &out, int d) { oneRegister(out, "lis $", d); }
+
+void Slt(Emitter &out, int d, int s, int t) {
+  threeRegisters(out, "slt $", d, s, t);
+}
+
+void Sltu(Emitter &out, int d, int s, int t) {
+  threeRegisters(out, "sltu $", d, s, t);
 }
 
-void Load(int t, int s, int i) {
-  std::cout << "lw $" << t << ", " << i << "($" << s << ")"
-            << "\n";
+void Jr(Emitter &out, int s) { oneRegister(out, "jr $", s); }
+
+void Jalr(Emitter &out, int s) { oneRegister(out, "jalr $", s); }
+
+void Beq(Emitter &out, int s, int t, std::string_view label) {
+  branch(out, "beq $", s, t, label);
 }
 
-void Store(int t, int s, int i) {
-  std::cout << "sw $" << t << ", " << i << "($" << s << ")"
-            << "\n";
+void Bne(Emitter &out, int s, int t, std::string_view label) {
+  branch(out, "bne $", s, t, label);
 }
 
-void Word(int i) { std::cout << ".word " << i << "\n"; }
+void Beq(Emitter &out, int s, int t, int i) { branch(out, "beq $", s, t, i); }
+
+void Bne(Emitter &out, int s, int t, int i) { branch(out, "bne $", s, t, i); }
 
-void Word(std::string label) { std::cout << ".word " + label + "\n"; }
+void Load(Emitter &out, int t, int s, int i) { memory(out, "lw $", t, s, i); }
 
-void Label(std::string name) { std::cout << name + ":\n"; }
+void Store(Emitter &out, int t, int s, int i) { memory(out, "sw $", t, s, i); }
+
+void Word(Emitter &out, int i) {
+  char *p = out.reserve(Emitter::MAX_LINE);
+  p = put(p, ".word ");
+  p = formatInt(p, i);
+  *p++ = '\n';
+  out.commit(p);
+}
+
+void Word(Emitter &out, std::string_view label) {
+  out.write(".word ");
+  out.write(label);
+  out.write("\n");
+}
+
+void Label(Emitter &out, std::string_view name) {
+  out.write(name);
+  out.write(":\n");
+}
 
-void push(int s) {
-  Store(s, 30, -4);
-  Subtract(30, 30, 4);
+void push(Emitter &out, int s) {
+  Store(out, s, 30, -4);
+  Subtract(out, 30, 30, 4);
 }
 
-void pop(int d) {
-  Add(30, 30, 4);
-  Load(d, 30, -4);
+void pop(Emitter &out, int d) {
+  Add(out, 30, 30, 4);
+  Load(out, d, 30, -4);
 }
 
-void pop() { Add(30, 30, 4); }
\ No newline at end of file
+void pop(Emitter &out) { Add(out, 30, 30, 4); }
@@ -1,51 +1,116 @@
+#ifndef MIPSINSTR_H
+#define MIPSINSTR_H
+
+#include <cstddef>
+#include <cstring>
+#include <iosfwd>
 #include <string>
+#include <string_view>
+
+// Collects assembly text in a fixed block and hands it on in large writes:
+// to sink when there is one, otherwise to an in-memory text (see take()).
+// Instructions are formatted straight into the block, so no temporary
+// strings are built.
+class Emitter {
+public:
+  // longest line formatted by one instruction below, labels aside
+  static constexpr std::size_t MAX_LINE = 64;
+
+  explicit Emitter(std::ostream *sink = nullptr) : sink{sink}, used{0} {}
+  Emitter(const Emitter &) = delete;
+  Emitter &operator=(const Emitter &) = delete;
+  ~Emitter() { flush(); }
+
+  // Space for at least n <= CAPACITY more bytes; the caller fills it and
+  // passes the end of what it wrote to commit
+  char *reserve(std::size_t n) {
+    if (CAPACITY - used < n) {
+      flush();
+    }
+    return block + used;
+  }
+  void commit(char *end) { used = end - block; }
+
+  void write(std::string_view s) {
+    if (s.size() > CAPACITY - used) {
+      flush();
+      if (s.size() > CAPACITY) {
+        drain(s.data(), s.size());
+        return;
+      }
+    }
+    std::memcpy(block + used, s.data(), s.size());
+    used += s.size();
+  }
+
+  // Passes the buffered text on
+  void flush();
+  // The text emitted so far, when there is no sink
+  std::string take();
+
+private:
+  static constexpr std::size_t CAPACITY = 1 << 16;
+  void drain(const char *data, std::size_t size);
+
+  std::ostream *sink;
+  std::string text;
+  std::size_t used;
+  char block[CAPACITY];
+};
+
+// Writes the decimal digits of i at p and returns the end
+char *formatInt(char *p, int i);
+
+// Each instruction below is written to out, one line per instruction
+
+void Add(Emitter &out, int d, int s, int t);
 
-void Add(int d, int s, int t);
+void Subtract(Emitter &out, int d, int s, int t);
 
-void Subtract(int d, int s, int t);
+void Multiply(Emitter &out, int s, int t);
 
-void Multiply(int s, int t);
+void MultiplyU(Emitter &out, int s, int t);
 
-void MultiplyU(int s, int t);
+void Divide(Emitter &out, int s, int t);
 
-void Divide(int s, int t);
+void DivideU(Emitter &out, int s, int t);
 
-void DivideU(int s, int t);
+void Mfhi(Emitter &out, int d);
 
-void Mfhi(int d);
+void Mflo(Emitter &out, int d);
 
-void Mflo(int d);
+void Lis(Emitter &out, int d);
 
-void Lis(int d);
+void Slt(Emitter &out, int d, int s, int t);
 
-void Slt(int d, int s, int t);
+void Sltu(Emitter &out, int d, int s, int t);
 
-void Sltu(int d, int s, int t);
+void Jr(Emitter &out, int s);
 
-void Jr(int s);
+void Jalr(Emitter &out, int s);
 
-void Jalr(int s);
+void Beq(Emitter &out, int s, int t, std::string_view label);
 
-void Beq(int s, int t, std::string label);
+void Bne(Emitter &out, int s, int t, std::string_view label);
 
-void Bne(int s, int t, std::string label);
+void Beq(Emitter &out, int s, int t, int i);
 
-void Beq(int s, int t, int i);
+void Bne(Emitter &out, int s, int t, int i);
 
-void Bne(int s, int t, int i);
+void Load(Emitter &out, int t, int s, int i = 0);
 
-void Load(int s, int t, int i = 0);
+void Store(Emitter &out, int t, int s, int i = 0);
 
-void Store(int s, int t, int i = 0);
+void Word(Emitter &out, int i);
 
-void Word(int i);
+void Word(Emitter &out, std::string_view label);
 
-void Word(std::string label);
+void Label(Emitter &out, std::string_view name);
 
-void Label(std::string name);
+void push(Emitter &out, int s);
 
-void push(int s);
+void pop(Emitter &out, int d);
 
-void pop(int d);
+void pop(Emitter &out);
 
-void pop();
\ No newline at end of file
+#endif // MIPSINSTR_H
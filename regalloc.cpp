@@ -0,0 +1,270 @@
+#include "regalloc.h"
+#include "cfg.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+struct LiveInterval {
+  std::int32_t vreg;
+  std::uint32_t start;
+  std::uint32_t end;
+  // uses and definitions, each counting 10 per enclosing loop
+  std::uint64_t weight = 0;
+};
+
+// Instruction i reads its operands at position 2i and writes its result at
+// 2i + 1, so an operand's interval may end where the result's begins and the
+// two share a register
+std::uint32_t usePosition(std::uint32_t instr) { return 2 * instr; }
+std::uint32_t definePosition(std::uint32_t instr) { return 2 * instr + 1; }
+
+bool endsBefore(const LiveInterval *a, const LiveInterval *b) {
+  return a->end < b->end;
+}
+
+bool startsBefore(const LiveInterval &a, const LiveInterval &b) {
+  return a.start < b.start;
+}
+
+// Intervals of the vregs that may get a register, by increasing start
+std::vector<LiveInterval> buildIntervals(const IrProcedure &ir) {
+  constexpr std::uint32_t UNUSED = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> start(ir.vregs, UNUSED);
+  std::vector<std::uint32_t> end(ir.vregs, 0);
+  std::vector<std::uint64_t> weight(ir.vregs, 0);
+  auto extend = [&](std::int32_t vreg, std::uint32_t position) {
+    start[vreg] = std::min(start[vreg], position);
+    end[vreg] = std::max(end[vreg], position);
+  };
+  const LoopNest &nest = loops(ir);
+  int blocks = ir.blocks.size();
+  for (int b = 0; b < blocks; ++b) {
+    std::uint64_t cost = 1;
+    for (std::uint32_t d = 0; d < std::min(nest.depth[b], 8u); ++d) {
+      cost *= 10;
+    }
+    for (std::uint32_t i = ir.blocks[b].begin; i < ir.blocks[b].end; ++i) {
+      const IrInstr &instr = ir.code[i];
+      forEachUse(ir, instr, [&](std::int32_t vreg) {
+        extend(vreg, usePosition(i));
+        weight[vreg] += cost;
+      });
+      if (instr.dst != NO_VREG) {
+        extend(instr.dst, definePosition(i));
+        weight[instr.dst] += cost;
+      }
+    }
+  }
+
+  // a variable live into a block is live from the block's start, and one
+  // live out of it up to its end. Only the first block in layout order a
+  // variable is live into and the last it is live out of can widen its
+  // interval, so each variable is visited once per direction.
+  const Liveness &live = liveness(ir);
+  std::vector<std::uint64_t> seen(live.words, 0);
+  auto visitNew = [&](const std::uint64_t *set, std::uint32_t position) {
+    for (std::uint32_t w = 0; w < live.words; ++w) {
+      std::uint64_t bits = set[w] & ~seen[w];
+      seen[w] |= bits;
+      for (; bits != 0; bits &= bits - 1) {
+        extend(64 * w + __builtin_ctzll(bits), position);
+      }
+    }
+  };
+  for (int b = 0; b < blocks; ++b) {
+    visitNew(live.in(b), usePosition(ir.blocks[b].begin));
+  }
+  std::fill(seen.begin(), seen.end(), 0);
+  for (int b = blocks - 1; b >= 0; --b) {
+    visitNew(live.out(b), definePosition(ir.blocks[b].end - 1));
+  }
+
+  std::vector<LiveInterval> intervals;
+  for (std::int32_t v = 0; v < ir.vregs; ++v) {
+    bool inFrame = !ir.isTemporary(v) && ir.inMemory[v];
+    if (start[v] != UNUSED && !inFrame) {
+      intervals.push_back({v, start[v], end[v], weight[v]});
+    }
+  }
+  std::stable_sort(intervals.begin(), intervals.end(), startsBefore);
+  return intervals;
+}
+
+// Per block: whether an edge jumps over it, forward from a block before it
+// to one after it, or backward from it or a later block to it or an
+// earlier one. Across any other block, control only gets from the code
+// before a point in it to the code after through that point.
+std::vector<bool> crossedBlocks(const IrProcedure &ir) {
+  int blocks = ir.blocks.size();
+  std::vector<int> edges(blocks + 1, 0);
+  for (int b = 0; b < blocks; ++b) {
+    for (std::int32_t s : ir.blocks[b].successors) {
+      if (s > b + 1) {
+        ++edges[b + 1];
+        --edges[s];
+      } else if (s >= 0 && s <= b) {
+        ++edges[s];
+        --edges[b + 1];
+      }
+    }
+  }
+  std::vector<bool> crossed(blocks);
+  int open = 0;
+  for (int b = 0; b < blocks; ++b) {
+    open += edges[b];
+    crossed[b] = open > 0;
+  }
+  return crossed;
+}
+
+} // namespace
+
+RegisterAllocation allocateRegisters(const IrProcedure &ir,
+                                     int registerCount) {
+  RegisterAllocation allocation;
+  std::vector<std::int8_t> &registers = allocation.registers;
+  std::vector<std::uint32_t> &splitAt = allocation.splitAt;
+  registers.assign(ir.vregs, NO_REGISTER);
+  splitAt.assign(ir.vregs, NO_SPLIT);
+  std::vector<LiveInterval> intervals = buildIntervals(ir);
+  std::vector<bool> crossed = crossedBlocks(ir);
+  // whether a vreg may move from its register to the frame just before
+  // instruction instr
+  auto splittable = [&](std::uint32_t instr) {
+    auto after = std::upper_bound(
+        ir.blocks.begin(), ir.blocks.end(), instr,
+        [](std::uint32_t i, const IrBlock &block) { return i < block.begin; });
+    return !crossed[after - ir.blocks.begin() - 1];
+  };
+
+  // free registers, the lowest taken first
+  std::vector<std::int8_t> free;
+  for (int r = FIRST_ALLOCATABLE_REGISTER + registerCount - 1;
+       r >= FIRST_ALLOCATABLE_REGISTER; --r) {
+    free.push_back(r);
+  }
+  // intervals holding a register, by increasing end
+  std::vector<const LiveInterval *> active;
+  for (const LiveInterval &current : intervals) {
+    std::size_t expired = 0;
+    while (expired < active.size() &&
+           active[expired]->end < current.start) {
+      free.push_back(registers[active[expired]->vreg]);
+      ++expired;
+    }
+    active.erase(active.begin(), active.begin() + expired);
+
+    if (!free.empty()) {
+      registers[current.vreg] = free.back();
+      free.pop_back();
+    } else {
+      // the lightest of current and the active intervals goes to the
+      // frame; of equal weights, the one ending last
+      const LiveInterval *victim = &current;
+      for (const LiveInterval *interval : active) {
+        if (interval->weight < victim->weight ||
+            (interval->weight == victim->weight &&
+             interval->end > victim->end)) {
+          victim = interval;
+        }
+      }
+      if (victim == &current) {
+        continue;
+      }
+      registers[current.vreg] = registers[victim->vreg];
+      // a split needs some of the victim's lifetime before the point
+      std::uint32_t instr = current.start / 2;
+      if (victim->start < usePosition(instr) && splittable(instr)) {
+        splitAt[victim->vreg] = instr;
+      } else {
+        registers[victim->vreg] = NO_REGISTER;
+      }
+      active.erase(std::find(active.begin(), active.end(), victim));
+    }
+    active.insert(std::upper_bound(active.begin(), active.end(), &current,
+                                   endsBefore),
+                  &current);
+  }
+  for (const LiveInterval &interval : intervals) {
+    if (splitAt[interval.vreg] != NO_SPLIT) {
+      allocation.splits.push_back(interval.vreg);
+    }
+  }
+  std::stable_sort(allocation.splits.begin(), allocation.splits.end(),
+                   [&](std::int32_t a, std::int32_t b) {
+                     return splitAt[a] < splitAt[b];
+                   });
+
+  // frame slots: one per local whose address is taken, then the lifetimes
+  // in the frame of the other locals and the temporaries in order of start,
+  // reusing the slots of lifetimes that ended
+  std::vector<std::int32_t> &slots = allocation.frameSlots;
+  slots.assign(ir.vregs, NO_SLOT);
+  for (std::int32_t v = ir.params; v < ir.variables; ++v) {
+    if (ir.inMemory[v]) {
+      slots[v] = allocation.frameWords++;
+    }
+  }
+  std::vector<LiveInterval> inFrame;
+  for (const LiveInterval &interval : intervals) {
+    std::int32_t v = interval.vreg;
+    if (v < ir.params) {
+      continue;
+    }
+    if (registers[v] == NO_REGISTER) {
+      inFrame.push_back(interval);
+    } else if (splitAt[v] != NO_SPLIT) {
+      inFrame.push_back({v, usePosition(splitAt[v]), interval.end});
+    }
+  }
+  std::stable_sort(inFrame.begin(), inFrame.end(), startsBefore);
+  std::vector<std::int32_t> freeSlots;
+  std::vector<const LiveInterval *> spilled;
+  for (const LiveInterval &current : inFrame) {
+    std::size_t expired = 0;
+    while (expired < spilled.size() &&
+           spilled[expired]->end < current.start) {
+      freeSlots.push_back(slots[spilled[expired]->vreg]);
+      ++expired;
+    }
+    spilled.erase(spilled.begin(), spilled.begin() + expired);
+    if (freeSlots.empty()) {
+      slots[current.vreg] = allocation.frameWords++;
+    } else {
+      slots[current.vreg] = freeSlots.back();
+      freeSlots.pop_back();
+    }
+    spilled.insert(std::upper_bound(spilled.begin(), spilled.end(), &current,
+                                    endsBefore),
+                   &current);
+  }
+
+  // registers of the intervals that span each call; a split interval holds
+  // its register until the instruction it is split at
+  std::size_t next = 0;
+  std::vector<const LiveInterval *> live;
+  for (std::uint32_t i = 0; i < ir.code.size(); ++i) {
+    if (ir.code[i].op != IR_CALL) {
+      continue;
+    }
+    for (; next < intervals.size() && intervals[next].start <= usePosition(i);
+         ++next) {
+      if (registers[intervals[next].vreg] != NO_REGISTER) {
+        live.push_back(&intervals[next]);
+      }
+    }
+    std::uint32_t saved = 0;
+    std::size_t kept = 0;
+    for (const LiveInterval *interval : live) {
+      std::int32_t v = interval->vreg;
+      if (interval->end > definePosition(i) && i < splitAt[v]) {
+        live[kept++] = interval;
+        saved |= std::uint32_t(1) << registers[v];
+      }
+    }
+    live.resize(kept);
+    allocation.savedAtCalls.push_back(saved);
+  }
+  return allocation;
+}
@@ -0,0 +1,57 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "ir.h"
+#include <cstdint>
+#include <vector>
+
+// Registers handed out to vregs. The others have fixed roles in the
+// generated code: $1 runtime arguments, $2 constants, $3 and $5 results and
+// operands of vregs kept in the frame, $4 the constant 4, $29 the frame
+// pointer, $30 the stack pointer and $31 the return address.
+constexpr int FIRST_ALLOCATABLE_REGISTER = 6;
+constexpr int LAST_ALLOCATABLE_REGISTER = 28;
+constexpr int ALLOCATABLE_REGISTERS =
+    LAST_ALLOCATABLE_REGISTER - FIRST_ALLOCATABLE_REGISTER + 1;
+
+// register of a vreg that lives in the frame
+constexpr std::int8_t NO_REGISTER = 0;
+// frame slot of a vreg that needs none
+constexpr std::int32_t NO_SLOT = -1;
+// split point of a vreg that keeps its register
+constexpr std::uint32_t NO_SPLIT = UINT32_MAX;
+
+struct RegisterAllocation {
+  // per vreg: its register, or NO_REGISTER
+  std::vector<std::int8_t> registers;
+  // per vreg with a register: the instruction from which it lives in its
+  // frame slot instead, or NO_SPLIT. The register is stored to the slot just
+  // before that instruction.
+  std::vector<std::uint32_t> splitAt;
+  // the vregs that are split, by increasing splitAt
+  std::vector<std::int32_t> splits;
+  // per vreg: the frame word it lives in, counted down from $29 (slot k is
+  // at -4k($29)), or NO_SLOT. Parameters live in the words their caller
+  // pushed; of the other vregs only those without a register or split get
+  // a slot, and vregs whose lifetimes in memory do not overlap share one.
+  std::vector<std::int32_t> frameSlots;
+  // frame words below $29
+  int frameWords = 0;
+  // per IR_CALL, in code order: bit r is set if register r holds a value
+  // that is still needed after the call, so the caller saves it
+  std::vector<std::uint32_t> savedAtCalls;
+};
+
+// Linear-scan allocation (Poletto and Sarkar) of the first registerCount
+// allocatable registers. Each vreg gets one interval, from the first to the
+// last point where it is used, defined or live in the blocks as laid out.
+// When more intervals overlap than there are registers, the one with the
+// lowest spill weight (its uses and definitions, each counting 10 per
+// enclosing loop) gives up its register. It is split at that point if
+// every path between the two parts runs through it, and otherwise spends
+// its whole lifetime in the frame. Variables whose address is taken always
+// do.
+RegisterAllocation allocateRegisters(const IrProcedure &ir,
+                                     int registerCount = ALLOCATABLE_REGISTERS);
+
+#endif // REGALLOC_H
@@ -1,15 +1,24 @@
 #include "scanner.h"
 #include <algorithm>
-#include <bitset>
+#include <array>
+#include <cstdint>
+#include <fcntl.h>
 #include <iostream>
-#include <map>
-#include <sstream>
 #include <stdexcept>
 #include <string>
-#include <tuple>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
 #include <vector>
 
-const std::string DFAstring = R"(
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+constexpr std::string_view DFAstring = R"(
 .STATES
 start
 ID!
@@ -77,510 +86,732 @@ start    ; ?COMMENT
 ?COMMENT \x00-\x09 \x0B \x0C \x0E-\x7F ?COMMENT
 )";
 
-const std::string STATES = ".STATES";
-const std::string TRANSITIONS = ".TRANSITIONS";
-const std::string INPUT = ".INPUT";
-
-class DFA {
-  // initial state
-  std::pair<std::string, bool> initState;
-  // name of current state + accepting characters + name of next state
-  std::map<std::pair<std::string, char>, std::pair<std::string, bool>>
-      transitionMap;
-
-public:
-  // Constructor
-  DFA(std::map<std::string, bool> states,
-      std::vector<
-          std::pair<std::pair<std::string, std::string>, std::vector<char>>>
-          transitions);
-  // Destructor
-  ~DFA();
-  // finds and return a state given the name of the state
-  std::pair<std::string, bool> findState(std::string stateName);
-  // gets the next state given the name of the current state and a char c
-  std::pair<std::string, bool> nextState(std::string currState, char c);
-  // retrieves the initial state of a DFA
-  std::pair<std::string, bool> getInitState() { return initState; }
-};
-
-/**************** Function Declarations ****************/
-
-/* String Processing Functions */
-// Checks if a string consists of exactly one character
-bool isChar(std::string s);
-
-// Checks if a string represents a valid character range (e.g. "a-z")
-bool isRange(std::string s);
+constexpr std::string_view STATES = ".STATES";
+constexpr std::string_view TRANSITIONS = ".TRANSITIONS";
+constexpr std::string_view INPUT = ".INPUT";
 
-// Normalizes whitespace in a string by removing leading/trailing spaces
-// and reducing multiple spaces to single spaces
-std::string squish(std::string s);
+/**************** Compile-time DFA Construction ****************/
+/*
+ * DFAstring is parsed by constexpr code into a dense state x 256 transition
+ * table. States are numbered in the order they appear under .STATES (so
+ * "start" is state 0) and NO_STATE marks a missing transition. When a
+ * (state, character) pair appears more than once the first transition wins.
+ */
 
-/* Hex Conversion Functions */
-// Converts a hex character (0-9, a-f, A-F) to its decimal value (0-15)
-int hexToNum(char c);
-
-// Converts a hexadecimal string to its binary representation
-std::string hexToBin(std::string hex);
-
-// Converts a decimal number (0-15) to its hex character representation
-char numToHex(int d);
+constexpr bool isSpaceChar(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
 
-/* Character Encoding Functions */
-// Processes escape sequences in a string (e.g. \n, \t) into actual characters
-std::string escape(std::string s);
+constexpr int hexValue(char c) {
+  return ('0' <= c && c <= '9')   ? c - '0'
+         : ('a' <= c && c <= 'f') ? 10 + (c - 'a')
+         : ('A' <= c && c <= 'F') ? 10 + (c - 'A')
+                                  : -1;
+}
 
-// Converts special characters into their escape sequence representation
-std::string unescape(std::string s);
+// Reads whitespace separated words (and whole lines) out of DFAstring
+struct SpecReader {
+  std::string_view text;
+  std::size_t pos = 0;
 
-/* Token Processing Functions */
-// Determines the specific token type for identifiers (e.g. if "int" -> "INT")
-std::string getIDType(std::string s);
+  constexpr bool atEnd() const { return pos >= text.size(); }
 
-// Validates tokens against language constraints (e.g. number ranges)
-void checkTokenRestriction(Token t);
+  // next word, or an empty view at end of input
+  constexpr std::string_view word() {
+    while (pos < text.size() && isSpaceChar(text[pos])) {
+      ++pos;
+    }
+    std::size_t begin = pos;
+    while (pos < text.size() && !isSpaceChar(text[pos])) {
+      ++pos;
+    }
+    return text.substr(begin, pos - begin);
+  }
 
-// Converts an input string into a sequence of tokens using a DFA
-std::vector<Token> tokenize(DFA *a, std::string in);
+  // rest of the current line, without the newline
+  constexpr std::string_view line() {
+    std::size_t begin = pos;
+    while (pos < text.size() && text[pos] != '\n') {
+      ++pos;
+    }
+    std::string_view result = text.substr(begin, pos - begin);
+    if (pos < text.size()) {
+      ++pos;
+    }
+    return result;
+  }
+};
 
-// Constructs a DFA from an input stream containing state and transition definitions
-DFA createDFA(std::istream &in);
+// Counts the states listed between .STATES and .TRANSITIONS
+constexpr int countStates(std::string_view spec) {
+  SpecReader in{spec};
+  while (in.word() != STATES) {
+    if (in.atEnd()) {
+      throw std::logic_error("DFA specification has no .STATES section");
+    }
+  }
+  int count = 0;
+  for (std::string_view w = in.word(); w != TRANSITIONS; w = in.word()) {
+    if (w.empty()) {
+      throw std::logic_error("DFA specification has no .TRANSITIONS section");
+    }
+    ++count;
+  }
+  return count;
+}
 
-/****************Function Definitions****************/
+// Decodes one character-or-range word of a transition line into the
+// [lo, hi] character range it denotes. A character may be written as \s,
+// \n, \r, \t, \xHH (ASCII only) or a backslash before itself.
+constexpr std::pair<char, char> decodeCharRange(std::string_view w) {
+  char decoded[3] = {};
+  int len = 0;
+  for (std::size_t i = 0; i < w.size(); ++i) {
+    char c = w[i];
+    if (c == '\\' && i + 1 < w.size()) {
+      char e = w[++i];
+      if (e == 's') {
+        c = ' ';
+      } else if (e == 'n') {
+        c = '\n';
+      } else if (e == 'r') {
+        c = '\r';
+      } else if (e == 't') {
+        c = '\t';
+      } else if (e == 'x' && i + 2 < w.size() && hexValue(w[i + 1]) >= 0 &&
+                 hexValue(w[i + 2]) >= 0) {
+        if (hexValue(w[i + 1]) > 7) {
+          throw std::logic_error("escape sequence not in ASCII range");
+        }
+        c = static_cast<char>(hexValue(w[i + 1]) * 16 + hexValue(w[i + 2]));
+        i += 2;
+      } else {
+        c = e;
+      }
+    }
+    if (len == 3) {
+      throw std::logic_error("expected character or range in transition");
+    }
+    decoded[len++] = c;
+  }
+  if (len == 1) {
+    return {decoded[0], decoded[0]};
+  } else if (len == 3 && decoded[1] == '-') {
+    return {decoded[0], decoded[2]};
+  }
+  throw std::logic_error("expected character or range in transition");
+}
 
-DFA::DFA(std::map<std::string, bool> states,
-         std::vector<
-             std::pair<std::pair<std::string, std::string>, std::vector<char>>>
-             transitions)
-    : initState{std::make_pair<std::string, bool>("start", 0)} {
+template <int N> struct DenseDFA {
+  static_assert(N < 255, "state IDs must fit in one byte");
+  static constexpr int NO_STATE = 0xFF;
+
+  std::string_view names[N] = {};
+  // token kind produced by each accepting state (TK_NONE for the discarded
+  // ?-prefixed states)
+  TokenKind kinds[N] = {};
+  unsigned char next[N][256] = {};
+  std::uint64_t accepting[(N + 63) / 64] = {};
+
+  constexpr int find(std::string_view name) const {
+    for (int i = 0; i < N; ++i) {
+      if (names[i] == name) {
+        return i;
+      }
+    }
+    throw std::logic_error("transition refers to an undeclared state");
+  }
 
-  for (auto it : transitions) {
-    for (auto it2 : it.second)
-      transitionMap.insert(
-          std::pair<std::pair<std::string, char>, std::pair<std::string, bool>>(
-              std::pair<std::string, char>(it.first.first, it2),
-              std::make_pair(it.first.second, states[it.first.second])));
+  constexpr bool isAccepting(int state) const {
+    return (accepting[state / 64] >> (state % 64)) & 1;
   }
-}
 
-DFA::~DFA() {}
+  constexpr int getInitState() const { return 0; }
 
-std::pair<std::string, bool> DFA::nextState(std::string currState, char c) {
-  // for each transition in 'transitions' check if the current state is the
-  // starting state of the transition
-  std::pair<std::string, char> key = std::pair<std::string, char>(currState, c);
-  if (transitionMap.find(key) != transitionMap.end()) {
-    return transitionMap[key];
+  // gets the next state given the current state and a char c, or NO_STATE
+  // if the DFA has no transition on c
+  int nextState(int state, char c) const {
+    return next[state][static_cast<unsigned char>(c)];
   }
-  throw std::runtime_error("NO TRANSITION TO NEXT STATE");
-}
 
-DFA createDFA(std::istream &in) {
-  std::map<std::string, bool> states;
-  std::vector<std::pair<std::pair<std::string, std::string>, std::vector<char>>>
-      transitions;
-  std::string s;
+  std::string_view stateName(int state) const { return names[state]; }
+};
 
-  // Read states
-  while (true) {
-    if (!(std::getline(in, s))) {
-      throw std::runtime_error("Expected " + STATES +
-                               ", but found end of input.");
-    }
-    s = squish(s);
-    if (s == STATES) {
-      break;
-    }
-    if (!s.empty()) {
-      throw std::runtime_error("Expected " + STATES + ", but found: " + s);
+template <int N> constexpr DenseDFA<N> buildDFA(std::string_view spec) {
+  DenseDFA<N> dfa;
+  for (auto &row : dfa.next) {
+    for (auto &cell : row) {
+      cell = DenseDFA<N>::NO_STATE;
     }
   }
-  // Read transitions
-  while (true) {
-    if (!(in >> s)) {
-      throw std::runtime_error(
-          "Unexpected end of input while reading state set: " + TRANSITIONS +
-          "not found.");
-    }
-    if (s == TRANSITIONS) {
-      break;
+
+  SpecReader in{spec};
+  while (in.word() != STATES) {
+  }
+  for (int i = 0; i < N; ++i) {
+    std::string_view name = in.word();
+    if (name.size() > 1 && name.back() == '!') {
+      name.remove_suffix(1);
+      dfa.accepting[i / 64] |= std::uint64_t{1} << (i % 64);
     }
-    bool accepting = false;
-    if (s.back() == '!' && s.length() > 1) {
-      accepting = true;
-      states.insert(std::make_pair(s.substr(0, s.length() - 1), accepting));
+    dfa.names[i] = name;
+    dfa.kinds[i] = name == "ZERO" ? TK_NUM : tokenKindFromName(name);
+    if (dfa.isAccepting(i) && dfa.kinds[i] == TK_NONE && name[0] != '?') {
+      throw std::logic_error("accepting state does not name a token kind");
     }
-    states.insert(std::make_pair(s, accepting));
   }
-  std::getline(in, s); // Consume newline after ".TRANSITIONS"
-
-  //Complex section: Parses transition lines, handles character ranges and escape sequences.
-  while (true) {
-    if (!(std::getline(in, s))) {
-      break;
+  in.word(); // .TRANSITIONS
+  in.line(); // rest of the .TRANSITIONS line
+
+  while (!in.atEnd()) {
+    SpecReader line{in.line()};
+    std::string_view words[16] = {};
+    int count = 0;
+    for (std::string_view w = line.word(); !w.empty(); w = line.word()) {
+      if (count == 16) {
+        throw std::logic_error("transition line too long");
+      }
+      words[count++] = w;
     }
-    s = squish(s);
-    if (s == INPUT) {
-      break;
+    if (count == 0) {
+      continue;
     }
-    std::string lineStr = s;
-    std::stringstream line(lineStr);
-    std::vector<std::string> lineVec;
-    while (line >> s) {
-      lineVec.push_back(s);
+    if (count == 1 && words[0] == INPUT) {
+      break;
     }
-    if (lineVec.empty()) {
-      continue;
+    if (count < 3) {
+      throw std::logic_error("incomplete transition line");
     }
-    if (lineVec.size() < 3) {
-      throw std::runtime_error("Incomplete transition line: " + lineStr);
-    }
-    std::string fromState = lineVec.front();
-    std::string toState = lineVec.back();
-    std::vector<char> charVec;
-    for (int i = 1; i < lineVec.size() - 1; ++i) {
-      std::string charOrRange = escape(lineVec[i]);
-      if (isChar(charOrRange)) {
-        char c = charOrRange[0];
-        if (c < 0 || c > 127) {
-          throw std::runtime_error(
-              "Invalid (non-ASCII) character in transition line: " + lineStr +
-              "\n" + "Character " + unescape(std::string(1, c)) +
-              " is outside ASCII range");
-        }
-        charVec.push_back(c);
-      } else if (isRange(charOrRange)) {
-        for (char c = charOrRange[0];
-             charOrRange[0] <= c && c <= charOrRange[2]; ++c) {
-          charVec.push_back(c);
+    int from = dfa.find(words[0]);
+    int to = dfa.find(words[count - 1]);
+    for (int i = 1; i < count - 1; ++i) {
+      std::pair<char, char> range = decodeCharRange(words[i]);
+      for (int c = range.first; c <= range.second; ++c) {
+        unsigned char &cell = dfa.next[from][c];
+        if (cell == DenseDFA<N>::NO_STATE) {
+          cell = static_cast<unsigned char>(to);
         }
-      } else {
-        throw std::runtime_error("Expected character or range, but found " +
-                                 charOrRange +
-                                 " in transition line: " + lineStr);
       }
     }
-    transitions.push_back(
-        std::make_pair(std::make_pair(fromState, toState), charVec));
   }
-
-  return DFA{states, transitions};
+  return dfa;
 }
 
-bool isChar(std::string s) { return s.length() == 1; }
+using DFA = DenseDFA<countStates(DFAstring)>;
 
-bool isRange(std::string s) { return s.length() == 3 && s[1] == '-'; }
+constexpr DFA SCANNER_DFA = buildDFA<countStates(DFAstring)>(DFAstring);
 
-std::string squish(std::string s) {
-  std::stringstream ss(s);
-  std::string token;
-  std::string result;
-  std::string space = "";
-  while (ss >> token) {
-    result += space;
-    result += token;
-    space = " ";
-  }
-  return result;
+static_assert(SCANNER_DFA.names[SCANNER_DFA.getInitState()] == "start",
+              "the scanner DFA must begin in the start state");
+
+/**************** Whitespace and Comment Skipping ****************/
+/*
+ * Whitespace runs and comment bodies loop on a single DFA state one byte at
+ * a time. Once the tokenizer enters one of those states it jumps straight
+ * to the first byte the state has no self-loop on, 16 (SSE2) or 32 (AVX2)
+ * bytes per step, and the DFA resumes from there.
+ */
+
+constexpr int WHITESPACE_STATE = SCANNER_DFA.find("?WHITESPACE");
+constexpr int COMMENT_STATE = SCANNER_DFA.find("?COMMENT");
+
+// bytes that keep the DFA in ?WHITESPACE
+constexpr bool isWhitespaceByte(unsigned char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 }
 
-int hexToNum(char c) {
-  if ('0' <= c && c <= '9') {
-    return c - '0';
-  } else if ('a' <= c && c <= 'f') {
-    return 10 + (c - 'a');
-  } else if ('A' <= c && c <= 'F') {
-    return 10 + (c - 'A');
+// bytes that end a comment: line breaks and anything outside ASCII
+constexpr bool endsComment(unsigned char c) {
+  return c == '\n' || c == '\r' || c >= 0x80;
+}
+
+// The vector predicates below hard-code these byte sets, so check them
+// against the table built from DFAstring
+constexpr bool skipSetsMatchDFA() {
+  for (int c = 0; c < 256; ++c) {
+    if ((SCANNER_DFA.next[WHITESPACE_STATE][c] == WHITESPACE_STATE) !=
+            isWhitespaceByte(c) ||
+        (SCANNER_DFA.next[COMMENT_STATE][c] == COMMENT_STATE) ==
+            endsComment(c)) {
+      return false;
+    }
   }
-  throw std::runtime_error("Invalid hex digit!");
+  return true;
 }
 
-std::string hexToBin(std::string hex) {
-  std::string bin = "";
-  for (auto it : hex) {
-    char check = toupper(it);
-    if (check == '0') {
-      bin += "0000";
-    } else if (check == '1') {
-      bin += "0001";
-    } else if (check == '2') {
-      bin += "0010";
-    } else if (check == '3') {
-      bin += "0011";
-    } else if (check == '4') {
-      bin += "0100";
-    } else if (check == '5') {
-      bin += "0101";
-    } else if (check == '6') {
-      bin += "0110";
-    } else if (check == '7') {
-      bin += "0111";
-    } else if (check == '8') {
-      bin += "1000";
-    } else if (check == '9') {
-      bin += "1001";
-    } else if (check == 'A') {
-      bin += "1010";
-    } else if (check == 'B') {
-      bin += "1011";
-    } else if (check == 'C') {
-      bin += "1100";
-    } else if (check == 'D') {
-      bin += "1101";
-    } else if (check == 'E') {
-      bin += "1110";
-    } else if (check == 'F') {
-      bin += "1111";
-    }
-  }
-  return bin;
+static_assert(skipSetsMatchDFA(),
+              "whitespace/comment skipping disagrees with DFAstring");
+
+#if defined(__AVX2__)
+// Bitmask of the whitespace bytes in the 32 bytes at p
+inline unsigned whitespaceMask(const char *p) {
+  __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  __m256i ws = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+  return static_cast<unsigned>(_mm256_movemask_epi8(ws));
 }
 
-char numToHex(int d) { return (d < 10 ? d + '0' : d - 10 + 'A'); }
-
-std::string escape(std::string s) {
-  std::string p;
-  for (int i = 0; i < s.length(); ++i) {
-    if (s[i] == '\\' && i + 1 < s.length()) {
-      char c = s[i + 1];
-      i = i + 1;
-      if (c == 's') {
-        p += ' ';
-      } else if (c == 'n') {
-        p += '\n';
-      } else if (c == 'r') {
-        p += '\r';
-      } else if (c == 't') {
-        p += '\t';
-      } else if (c == 'x') {
-        if (i + 2 < s.length() && isxdigit(s[i + 1]) && isxdigit(s[i + 2])) {
-          if (hexToNum(s[i + 1]) > 8) {
-            throw std::runtime_error("Invalid escape sequence \\x" +
-                                     std::string(1, s[i + 1]) +
-                                     std::string(1, s[i + 2]) +
-                                     ": not in ASCII range (0x00 to 0x7F)");
-          }
-          char code = hexToNum(s[i + 1]) * 16 + hexToNum(s[i + 2]);
-          p += code;
-          i = i + 2;
-        } else {
-          p += c;
-        }
-      } else if (isgraph(c)) {
-        p += c;
-      } else {
-        p += s[i];
-      }
-    } else {
-      p += s[i];
+// Bitmask of the comment-ending bytes in the 32 bytes at p
+inline unsigned commentEndMask(const char *p) {
+  __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  __m256i breaks =
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+  // the sign bit of each byte is set exactly for non-ASCII bytes
+  return static_cast<unsigned>(
+      _mm256_movemask_epi8(_mm256_or_si256(breaks, v)));
+}
+
+constexpr std::size_t SKIP_STRIDE = 32;
+constexpr unsigned STRIDE_MASK = 0xFFFFFFFFu;
+#elif defined(__SSE2__)
+// Bitmask of the whitespace bytes in the 16 bytes at p
+inline unsigned whitespaceMask(const char *p) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  __m128i ws =
+      _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                   _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+  return static_cast<unsigned>(_mm_movemask_epi8(ws));
+}
+
+// Bitmask of the comment-ending bytes in the 16 bytes at p
+inline unsigned commentEndMask(const char *p) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  __m128i breaks = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+  // the sign bit of each byte is set exactly for non-ASCII bytes
+  return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(breaks, v)));
+}
+
+constexpr std::size_t SKIP_STRIDE = 16;
+constexpr unsigned STRIDE_MASK = 0xFFFFu;
+#endif
+
+// Returns the index of the first byte at or after index that is not
+// whitespace (or in.length())
+std::size_t skipWhitespace(std::string_view in, std::size_t index) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  while (in.length() - index >= SKIP_STRIDE) {
+    unsigned other = ~whitespaceMask(in.data() + index) & STRIDE_MASK;
+    if (other) {
+      return index + __builtin_ctz(other);
+    }
+    index += SKIP_STRIDE;
+  }
+#endif
+  while (index < in.length() && isWhitespaceByte(in[index])) {
+    index++;
+  }
+  return index;
+}
+
+// Returns the index of the first byte at or after index that ends a comment
+// (or in.length())
+std::size_t skipCommentBody(std::string_view in, std::size_t index) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  while (in.length() - index >= SKIP_STRIDE) {
+    unsigned stop = commentEndMask(in.data() + index);
+    if (stop) {
+      return index + __builtin_ctz(stop);
     }
+    index += SKIP_STRIDE;
   }
-  return p;
+#endif
+  while (index < in.length() && !endsComment(in[index])) {
+    index++;
+  }
+  return index;
 }
 
-std::string unescape(std::string s) {
-  std::string p;
-  for (int i = 0; i < s.length(); ++i) {
-    char c = s[i];
-    if (c == ' ') {
-      p += "\\s";
-    } else if (c == '\n') {
-      p += "\\n";
-    } else if (c == '\r') {
-      p += "\\r";
-    } else if (c == '\t') {
-      p += "\\t";
-    } else if (!isgraph(c)) {
-      std::string hex = "\\x";
-      p += hex + numToHex((unsigned char)c / 16) +
-           numToHex((unsigned char)c % 16);
-    } else {
-      p += c;
-    }
-  }
-  return p;
+/**************** Function Declarations ****************/
+
+/* Token Processing Functions */
+// Determines the specific token kind for identifiers (e.g. "int" -> TK_INT)
+TokenKind getIDType(std::string_view s);
+
+// Validates tokens against language constraints (e.g. number ranges)
+void checkTokenRestriction(const Token &t);
+
+// Builds the token for a lexeme that ended in the accepting state `state`
+Token makeToken(const DFA &a, int state, std::string_view value,
+                InternTable &names);
+
+// Scans the token starting at in[index] by maximal munch and advances index
+// past it; whitespace and comments come back as TK_NONE tokens
+Token scanToken(const DFA &a, std::string_view in, std::size_t &index,
+                InternTable &names);
+
+// Converts an input string into a sequence of tokens using a DFA
+std::vector<Token> tokenize(const DFA &a, std::string_view in,
+                            InternTable &names);
+
+// Same result as tokenize, but the input is cut into line-aligned chunks
+// that are tokenized on up to `threads` threads and stitched back together
+std::vector<Token> tokenizeParallel(const DFA &a, std::string_view in,
+                                    InternTable &names, unsigned threads);
+
+/****************Function Definitions****************/
+
+struct KeywordSlot {
+  std::string_view keyword;
+  TokenKind kind;
+};
+
+// Perfect hash of a keyword candidate: (3 * first char + 4 * length) mod 16
+// is distinct for all ten WLP4 keywords
+constexpr unsigned keywordHash(std::size_t length, char first) {
+  return (3u * static_cast<unsigned char>(first) + 4u * length) & 15u;
 }
 
-std::string getIDType(std::string s) {
-  if (s == "int") {
-    return "INT";
-  } else if (s == "wain") {
-    return "WAIN";
-  } else if (s == "if") {
-    return "IF";
-  } else if (s == "else") {
-    return "ELSE";
-  } else if (s == "while") {
-    return "WHILE";
-  } else if (s == "println") {
-    return "PRINTLN";
-  } else if (s == "return") {
-    return "RETURN";
-  } else if (s == "new") {
-    return "NEW";
-  } else if (s == "delete") {
-    return "DELETE";
-  } else if (s == "NULL") {
-    return "NULL";
-  } else {
-    return "ID";
+constexpr std::array<KeywordSlot, 16> buildKeywordTable() {
+  constexpr KeywordSlot keywords[] = {
+      {"int", TK_INT},       {"wain", TK_WAIN},   {"if", TK_IF},
+      {"else", TK_ELSE},     {"while", TK_WHILE}, {"println", TK_PRINTLN},
+      {"return", TK_RETURN}, {"new", TK_NEW},     {"delete", TK_DELETE},
+      {"NULL", TK_NULL}};
+  std::array<KeywordSlot, 16> table = {};
+  for (const KeywordSlot &k : keywords) {
+    KeywordSlot &slot = table[keywordHash(k.keyword.size(), k.keyword[0])];
+    if (!slot.keyword.empty()) {
+      throw std::logic_error("keyword hash collision");
+    }
+    slot = k;
   }
+  return table;
+}
+
+constexpr std::array<KeywordSlot, 16> KEYWORD_TABLE = buildKeywordTable();
+
+TokenKind getIDType(std::string_view s) {
+  // the only keyword s could be lives in its hash slot, so a single
+  // comparison decides between that keyword and a plain identifier
+  const KeywordSlot &slot = KEYWORD_TABLE[keywordHash(s.length(), s[0])];
+  return s == slot.keyword ? slot.kind : TK_ID;
 }
 
-void checkTokenRestriction(Token t) {
+void checkTokenRestriction(const Token &t) {
   // looks for restrictions provided in instructions and throws an error if
   // anything is out-of-range
-  if (t.type == "NUM") {
-    try {
-      long tempLong = std::stol(t.value);
-      if (tempLong > 2147483647) {
-        throw std::runtime_error("NUM OUT-OF-RANGE");
+  if (t.kind == TK_NUM) {
+    long long value = 0;
+    for (char c : t.value) {
+      value = value * 10 + (c - '0');
+      if (value > 2147483647) {
+        throw ScanError("NUM OUT-OF-RANGE");
       }
-    } catch (std::out_of_range err) {
-      throw std::runtime_error("NUM OUT-OF-RANGE");
     }
   }
 }
 
-std::vector<Token> tokenize(DFA *a, std::string in) {
-  // stores the current state (always the initial state at the start)
-  std::pair<std::string, bool> currState = a->getInitState();
-  // constructs a token to be two empty strings
-  Token t = {"", ""};
-  std::string tokenValue;
+Token makeToken(const DFA &a, int state, std::string_view value,
+                InternTable &names) {
+  Token t{a.kinds[state], 0, value};
+  if (t.kind == TK_ID) {
+    t.kind = getIDType(value);
+  }
+  checkTokenRestriction(t);
+  if (t.kind == TK_ID || t.kind == TK_NUM) {
+    t.id = names.intern(value);
+  }
+  return t;
+}
+
+Token scanToken(const DFA &a, std::string_view in, std::size_t &index,
+                InternTable &names) {
+  // maximal munch: follow transitions from the initial state until the DFA
+  // reports NO_STATE or the input runs out
+  int currState = a.getInitState();
+  std::size_t begin = index;
+  while (index < in.length()) {
+    int nextState = a.nextState(currState, in[index]);
+    if (nextState == DFA::NO_STATE) {
+      break;
+    }
+    currState = nextState;
+    index++;
+    if (currState == WHITESPACE_STATE) {
+      index = skipWhitespace(in, index);
+    } else if (currState == COMMENT_STATE) {
+      index = skipCommentBody(in, index);
+    }
+  }
+  // the longest match must end in an accepting state
+  if (!a.isAccepting(currState)) {
+    throw ScanError("SCAN FAILURE");
+  }
+  return makeToken(a, currState, in.substr(begin, index - begin), names);
+}
+
+std::vector<Token> tokenize(const DFA &a, std::string_view in,
+                            InternTable &names) {
   // vector to store valid tokens
   std::vector<Token> vTokens;
   vTokens.reserve(in.length() / 2);
 
-  int index = 0;
+  // an empty input never leaves the (non-accepting) start state
+  if (in.empty()) {
+    throw ScanError("SCAN FAILURE");
+  }
 
-  // goes through each character in the given string and forms the token
+  std::size_t index = 0;
   while (index < in.length()) {
-    // stores the first character of the string
-    char tempChar = in[index];
+    Token t = scanToken(a, in, index, names);
+    // whitespace and comments are discarded, everything else is added to the
+    // vector of valid tokens
+    if (t.kind != TK_NONE) {
+      vTokens.push_back(t);
+    }
+  }
+  return vTokens;
+}
+
+/*
+ * Parallel tokenization
+ *
+ * The only lexer state that survives a newline is "inside a whitespace run":
+ * comments stop before '\n' and no other token contains one. A chunk that
+ * starts right after a newline can therefore be tokenized from the start
+ * state and lands on the same token boundaries as the sequential scan; at
+ * worst one whitespace run is split in two, and whitespace is discarded.
+ *
+ * Each chunk interns into its own table. The tables are merged in chunk
+ * order, which hands out global ids in first-occurrence order exactly as
+ * the sequential scan does, and the chunk's ids are then remapped. Errors
+ * are taken from the earliest failing chunk, which is the chunk containing
+ * the first invalid byte.
+ */
+
+struct ScanChunk {
+  std::string_view text;
+  std::vector<Token> tokens;
+  InternTable names;
+  // id in the merged table of each local id
+  std::vector<std::uint32_t> remap;
+  bool failed = false;
+  std::string error;
+};
+
+std::vector<Token> tokenizeParallel(const DFA &a, std::string_view in,
+                                    InternTable &names, unsigned threads) {
+  if (threads <= 1 || in.empty()) {
+    return tokenize(a, in, names);
+  }
+
+  // cut points are advanced to just past the next newline; a chunk without
+  // a newline in it is absorbed by its predecessor
+  std::vector<ScanChunk> chunks;
+  std::size_t begin = 0;
+  for (unsigned i = 1; i <= threads && begin < in.length(); ++i) {
+    std::size_t end = in.length() * i / threads;
+    if (i < threads) {
+      end = std::max(end, begin);
+      end = in.find('\n', end);
+      end = end == std::string_view::npos ? in.length() : end + 1;
+    }
+    if (end > begin) {
+      chunks.emplace_back();
+      chunks.back().text = in.substr(begin, end - begin);
+      begin = end;
+    }
+  }
+
+  auto scanChunk = [&a](ScanChunk &chunk) {
+    chunk.tokens.reserve(chunk.text.length() / 4);
     try {
-      // gets the next state and stores as a temporary state
-      std::pair<std::string, bool> tempState =
-          a->nextState(currState.first, tempChar);
-      // sets the current state to be the temporary state
-      currState = tempState;
-      // adds the character to the value of the current token
-      tokenValue += tempChar;
-      index++;
-      // if any errors are thrown, we catch it as there is no next state
-    } catch (std::runtime_error &e) {
-      // if the current state is an accepting state
-      if (currState.second) {
-        // we set the type and check for restrictions
-        if (currState.first == "ID") {
-          t.type = getIDType(tokenValue);
-        } else {
-          t.type = (currState.first == "ZERO" ? "NUM" : currState.first);
+      std::size_t index = 0;
+      while (index < chunk.text.length()) {
+        Token t = scanToken(a, chunk.text, index, chunk.names);
+        if (t.kind != TK_NONE) {
+          chunk.tokens.push_back(t);
         }
-        t.value = tokenValue;
-        checkTokenRestriction(t);
-        // if the type begins with '?' we discard the token, otherwise we add it
-        // too the vector of valid tokens
-        if (t.type[0] != '?') {
-          vTokens.push_back(t);
-        }
-        // reset the state and the current token
-        currState = a->getInitState();
-        tokenValue.clear();
-        t = {"", ""};
-        // if the state is not accepting, we throw a scan failure
-      } else {
-        throw std::runtime_error("SCAN FAILURE");
       }
+    } catch (ScanError &e) {
+      chunk.failed = true;
+      chunk.error = e.what();
     }
+  };
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < chunks.size(); ++i) {
+    workers.emplace_back(scanChunk, std::ref(chunks[i]));
   }
-  if (currState.second) {
-    t.type = (currState.first == "ZERO" ? "DECINT" : currState.first);
-    t.value = tokenValue;
-    checkTokenRestriction(t);
-    if (t.type[0] != '?') {
-      vTokens.push_back(t);
+  scanChunk(chunks[0]);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  // merge the intern tables in source order and place each chunk's tokens
+  std::vector<std::size_t> offsets;
+  std::size_t total = 0;
+  for (ScanChunk &chunk : chunks) {
+    chunk.remap.reserve(chunk.names.names.size());
+    for (std::string_view name : chunk.names.names) {
+      chunk.remap.push_back(name.empty() ? 0 : names.intern(name));
     }
-  } else {
-    throw std::runtime_error("SCAN FAILURE");
+    // the failing chunk's names are still merged so that names ends up
+    // holding what the sequential scan had interned when it stopped
+    if (chunk.failed) {
+      throw ScanError(chunk.error);
+    }
+    offsets.push_back(total);
+    total += chunk.tokens.size();
+  }
+
+  std::vector<Token> vTokens(total);
+  auto copyChunk = [&vTokens](const ScanChunk &chunk, std::size_t offset) {
+    Token *out = vTokens.data() + offset;
+    for (const Token &t : chunk.tokens) {
+      *out = t;
+      out->id = chunk.remap[t.id];
+      ++out;
+    }
+  };
+  workers.clear();
+  for (std::size_t i = 1; i < chunks.size(); ++i) {
+    workers.emplace_back(copyChunk, std::cref(chunks[i]), offsets[i]);
+  }
+  copyChunk(chunks[0], offsets[0]);
+  for (std::thread &worker : workers) {
+    worker.join();
   }
   return vTokens;
 }
 
-bool validLine(std::vector<Token> tokensCheck) {
-  if (tokensCheck[0].type == "DOTID" && tokensCheck[0].value == ".word" &&
-      tokensCheck.size() == 2) {
-    if (tokensCheck[1].type == "DECINT" || tokensCheck[1].type == "HEXINT" ||
-        tokensCheck[1].type == "ID")
-      return true;
-  } else if (tokensCheck[0].type == "ID" &&
-             (tokensCheck[0].value == "add" || tokensCheck[0].value == "sub" ||
-              tokensCheck[0].value == "slt" || tokensCheck[0].value == "sltu" ||
-              tokensCheck[0].value == "beq" || tokensCheck[0].value == "bne") &&
-             tokensCheck.size() == 6) {
-    if (tokensCheck[1].type == "REGISTER" && tokensCheck[2].type == "COMMA" &&
-        tokensCheck[3].type == "REGISTER" && tokensCheck[4].type == "COMMA" &&
-        tokensCheck[5].type == "REGISTER") {
-      return true;
-    } else if (tokensCheck[1].type == "REGISTER" &&
-               tokensCheck[2].type == "COMMA" &&
-               tokensCheck[3].type == "REGISTER" &&
-               tokensCheck[4].type == "COMMA" &&
-               (tokensCheck[5].type == "ID" ||
-                tokensCheck[5].type == "DECINT" ||
-                tokensCheck[5].type == "HEXINT")) {
-      return true;
-    }
-  } else if (tokensCheck[0].type == "ID" &&
-             (tokensCheck[0].value == "mult" ||
-              tokensCheck[0].value == "multu" ||
-              tokensCheck[0].value == "div" ||
-              tokensCheck[0].value == "divu") &&
-             tokensCheck.size() == 4) {
-    if (tokensCheck[1].type == "REGISTER" && tokensCheck[2].type == "COMMA" &&
-        tokensCheck[3].type == "REGISTER") {
-      return true;
-    }
-  } else if (tokensCheck[0].type == "ID" &&
-             (tokensCheck[0].value == "mfhi" ||
-              tokensCheck[0].value == "mflo" || tokensCheck[0].value == "lis" ||
-              tokensCheck[0].value == "jalr" || tokensCheck[0].value == "jr") &&
-             tokensCheck.size() == 2) {
-    if (tokensCheck[1].type == "REGISTER") {
-      return true;
-    }
-  } else if (tokensCheck[0].type == "ID" &&
-             (tokensCheck[0].value == "lw" || tokensCheck[0].value == "sw") &&
-             tokensCheck.size() == 7) {
-    if (tokensCheck[1].type == "REGISTER" && tokensCheck[2].type == "COMMA" &&
-        (tokensCheck[3].type == "HEXINT" || tokensCheck[3].type == "DECINT") &&
-        tokensCheck[4].type == "LPAREN" && tokensCheck[5].type == "REGISTER" &&
-        tokensCheck[6].type == "RPAREN") {
-      return true;
-    }
-  }
-  return false;
+SourceBuffer::SourceBuffer() : data{""}, size{0}, mapping{nullptr} {}
+
+SourceBuffer::SourceBuffer(SourceBuffer &&other)
+    : data{other.data}, size{other.size}, mapping{other.mapping},
+      owned{std::move(other.owned)} {
+  if (!mapping) {
+    data = owned.data();
+  }
+  other.mapping = nullptr;
+  other.owned.clear();
+  other.data = "";
+  other.size = 0;
 }
 
-int scan(std::vector<Token> &testVecToken) {
-  std::istringstream iss{DFAstring};
-  try {
-    DFA newDFA = createDFA(iss);
-
-    std::string testString = "";
-    char tempC;
-    while (true) {
-      tempC = getchar();
-      if (tempC == EOF) {
-        break;
-      }
-      testString += tempC;
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) {
+  if (this != &other) {
+    this->~SourceBuffer();
+    new (this) SourceBuffer(std::move(other));
+  }
+  return *this;
+}
+
+SourceBuffer::~SourceBuffer() {
+  if (mapping) {
+    munmap(mapping, size);
+  }
+}
+
+SourceBuffer SourceBuffer::mapFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("cannot stat " + path);
+  }
+  SourceBuffer buffer;
+  if (st.st_size > 0) {
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("cannot map " + path);
+    }
+    // the scanner walks the file front to back exactly once
+    madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+    buffer.mapping = mapped;
+    buffer.data = static_cast<const char *>(mapped);
+    buffer.size = st.st_size;
+  }
+  close(fd);
+  return buffer;
+}
+
+SourceBuffer SourceBuffer::readStream(std::FILE *in) {
+  SourceBuffer buffer;
+  const std::size_t blockSize = 1 << 16;
+  std::size_t length = 0;
+  while (true) {
+    buffer.owned.resize(length + blockSize);
+    std::size_t got = std::fread(&buffer.owned[length], 1, blockSize, in);
+    length += got;
+    if (got < blockSize) {
+      break;
+    }
+  }
+  buffer.owned.resize(length);
+  buffer.data = buffer.owned.data();
+  buffer.size = length;
+  return buffer;
+}
+
+std::uint32_t InternTable::intern(std::string_view s) {
+  auto it = ids.find(s);
+  if (it != ids.end()) {
+    return it->second;
+  }
+  std::uint32_t id = names.size();
+  ids.emplace(s, id);
+  names.push_back(s);
+  return id;
+}
+
+Scanner::Scanner(std::string_view input, InternTable &names)
+    : input{input}, index{0}, names{names}, started{false} {}
+
+Token Scanner::next() {
+  if (!started) {
+    started = true;
+    return Token{TK_BOF, 0, "BOF"};
+  }
+  // an empty input never leaves the (non-accepting) start state
+  if (input.empty()) {
+    throw ScanError("SCAN FAILURE");
+  }
+  while (index < input.length()) {
+    Token t = scanToken(SCANNER_DFA, input, index, names);
+    if (t.kind != TK_NONE) {
+      return t;
     }
-    testVecToken = tokenize(&newDFA, testString);
+  }
+  return Token{TK_EOF, 0, "EOF"};
+}
+
+TokenVectorStream::TokenVectorStream(const std::vector<Token> &tokens)
+    : tokens{tokens}, index{0}, started{false} {}
+
+Token TokenVectorStream::next() {
+  if (!started) {
+    started = true;
+    return Token{TK_BOF, 0, "BOF"};
+  }
+  if (index < tokens.size()) {
+    return tokens[index++];
+  }
+  return Token{TK_EOF, 0, "EOF"};
+}
+
+int scan(std::string_view text, std::vector<Token> &testVecToken,
+         InternTable &names, std::ostream &diagnostics, unsigned threads) {
+  if (threads == 0) {
+    threads = text.length() < PARALLEL_SCAN_MIN_BYTES
+                  ? 1
+                  : std::max(1u, std::thread::hardware_concurrency());
+  }
+  try {
+    testVecToken = tokenizeParallel(SCANNER_DFA, text, names, threads);
   } catch (std::runtime_error &e) {
-    std::cerr << "ERROR: " << e.what() << "\n";
+    diagnostics << "ERROR: " << e.what() << "\n";
     return 1;
   }
   return 0;
-}
\ No newline at end of file
+}
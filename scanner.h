@@ -1,4 +1,71 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
 #include "structures.h"
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Source text of one compilation, either memory-mapped from a file or read
+// from a stream in large blocks. Tokens refer into this buffer, so it must
+// outlive them.
+class SourceBuffer {
+  const char *data;
+  std::size_t size;
+  // non-null when data points into a private read-only file mapping
+  void *mapping;
+  // backing storage when the text was read from a stream
+  std::string owned;
+
+public:
+  SourceBuffer();
+  SourceBuffer(SourceBuffer &&other);
+  SourceBuffer &operator=(SourceBuffer &&other);
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+  ~SourceBuffer();
+
+  // Maps the file at path read-only; throws std::runtime_error on failure
+  static SourceBuffer mapFile(const std::string &path);
+  // Reads all of in into an owned buffer
+  static SourceBuffer readStream(std::FILE *in);
+
+  std::string_view text() const { return std::string_view(data, size); }
+};
+
+// Streams the tokens of input, scanning each one only when the parser asks
+// for it. Lexemes are interned into names as they are scanned.
+class Scanner : public TokenStream {
+  std::string_view input;
+  std::size_t index;
+  InternTable &names;
+  // whether BOF has been handed out yet
+  bool started;
+
+public:
+  Scanner(std::string_view input, InternTable &names);
+  Token next() override;
+};
+
+// Streams an already scanned token vector, adding BOF and EOF around it
+class TokenVectorStream : public TokenStream {
+  const std::vector<Token> &tokens;
+  std::size_t index;
+  bool started;
+
+public:
+  explicit TokenVectorStream(const std::vector<Token> &tokens);
+  Token next() override;
+};
+
+// Sources at least this large are tokenized on several threads by scan()
+constexpr std::size_t PARALLEL_SCAN_MIN_BYTES = 1 << 20;
+
+// Scans source and populates token vector, interning ID and NUM lexemes into
+// names; returns 0 on success and reports a failure to diagnostics. Tokens
+// refer into source. threads == 0 picks one thread for small sources and one
+// per hardware thread from PARALLEL_SCAN_MIN_BYTES up.
+int scan(std::string_view source, std::vector<Token> &testVecToken,
+         InternTable &names, std::ostream &diagnostics, unsigned threads = 0);
 
-// Scans input and populates token vector, returns 0 on success
-int scan(std::vector<Token> &testVecToken);
\ No newline at end of file
+#endif // SCANNER_H
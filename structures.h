@@ -2,17 +2,25 @@
 #ifndef STRUCTURES_H
 #define STRUCTURES_H
 
+#include <array>
+#include <cstdint>
 #include <deque>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 // Forward declarations
+class Emitter;
 struct Rule;
-struct SLR1DFA;
 struct Token;
+struct InternTable;
+class TokenStream;
+struct ParseTree;
 struct Treenode;
 struct Variable;
 struct VariableTable;
@@ -23,72 +31,290 @@ struct ProcedureTable;
 struct Rule {
   std::string lhs;
   std::vector<std::string> rhs;
-  void print(std::ostream &out = std::cout);
+  void print(std::ostream &out = std::cout) const;
 };
 
-// Deterministic Finite Automaton for SLR(1) parsing
-struct SLR1DFA {
-  std::map<std::pair<int, std::string>, int> transitions;
-  std::map<std::pair<int, std::string>, int> reductions;
-  void print(std::ostream &out = std::cout);
+// Terminal symbols of WLP4, shared by the scanner and the parser.
+// TOKEN_KIND_NAMES holds the grammar spelling of each kind.
+enum TokenKind : std::uint8_t {
+  TK_BOF,
+  TK_EOF,
+  TK_ID,
+  TK_NUM,
+  TK_LPAREN,
+  TK_RPAREN,
+  TK_LBRACE,
+  TK_RBRACE,
+  TK_LBRACK,
+  TK_RBRACK,
+  TK_BECOMES,
+  TK_PLUS,
+  TK_MINUS,
+  TK_STAR,
+  TK_SLASH,
+  TK_PCT,
+  TK_AMP,
+  TK_COMMA,
+  TK_SEMI,
+  TK_LT,
+  TK_GT,
+  TK_LE,
+  TK_GE,
+  TK_EQ,
+  TK_NE,
+  TK_INT,
+  TK_WAIN,
+  TK_IF,
+  TK_ELSE,
+  TK_WHILE,
+  TK_PRINTLN,
+  TK_RETURN,
+  TK_NEW,
+  TK_DELETE,
+  TK_NULL,
+  TK_COUNT,
+  // lexemes that are discarded (whitespace and comments)
+  TK_NONE = TK_COUNT
 };
 
-// Represents a lexical token with type and value
+constexpr std::string_view TOKEN_KIND_NAMES[TK_COUNT] = {
+    "BOF", "EOF", "ID", "NUM", "LPAREN", "RPAREN", "LBRACE", "RBRACE", "LBRACK",
+    "RBRACK", "BECOMES", "PLUS", "MINUS", "STAR", "SLASH", "PCT", "AMP",
+    "COMMA", "SEMI", "LT", "GT", "LE", "GE", "EQ", "NE", "INT", "WAIN", "IF",
+    "ELSE", "WHILE", "PRINTLN", "RETURN", "NEW", "DELETE", "NULL"};
+
+// Returns the kind spelled name, or TK_NONE if name is not a terminal
+constexpr TokenKind tokenKindFromName(std::string_view name) {
+  for (int i = 0; i < TK_COUNT; ++i) {
+    if (TOKEN_KIND_NAMES[i] == name) {
+      return static_cast<TokenKind>(i);
+    }
+  }
+  return TK_NONE;
+}
+
+// Types of WLP4 values. Only expression-like nodes of the parse tree get a
+// type; every other node keeps TYPE_NONE.
+enum ValueType : std::uint8_t { TYPE_NONE, TYPE_INT, TYPE_INT_PTR };
+
+constexpr std::string_view VALUE_TYPE_NAMES[] = {"", "int", "int*"};
+
+// Parameter types of a procedure. The first INLINE_TYPES are stored in
+// place; only longer signatures allocate.
+struct Signature {
+  static constexpr std::size_t INLINE_TYPES = 8;
+  std::uint32_t count = 0;
+  std::array<ValueType, INLINE_TYPES> inlineTypes{};
+  std::vector<ValueType> overflow;
+  std::size_t size() const { return count; }
+  ValueType operator[](std::size_t i) const {
+    return i < INLINE_TYPES ? inlineTypes[i] : overflow[i - INLINE_TYPES];
+  }
+  void push_back(ValueType t) {
+    if (count < INLINE_TYPES) {
+      inlineTypes[count] = t;
+    } else {
+      overflow.push_back(t);
+    }
+    ++count;
+  }
+};
+
+// Represents a lexical token: its kind, the lexeme as a view into the
+// scanned source buffer, and for ID and NUM tokens the interned ID of the
+// lexeme (0 otherwise)
 struct Token {
-  std::string type;
-  std::string value;
-  void print(std::ostream &out = std::cout);
+  TokenKind kind;
+  std::uint32_t id;
+  std::string_view value;
+  std::string_view typeName() const { return TOKEN_KIND_NAMES[kind]; }
+  void print(std::ostream &out = std::cout) const;
+};
+
+// Lexical error (invalid character sequence or out-of-range number)
+struct ScanError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// Pull-based source of tokens for the parser. The stream synthesizes a BOF
+// token first and an EOF token after the last real token; next() throws
+// ScanError when the input is not lexically valid.
+class TokenStream {
+public:
+  virtual ~TokenStream() = default;
+  virtual Token next() = 0;
+};
+
+// Maps each distinct ID/NUM spelling to a dense integer ID. ID 0 is the
+// empty string, so tokens without a value can use it.
+struct InternTable {
+  std::unordered_map<std::string_view, std::uint32_t> ids;
+  std::vector<std::string_view> names{""};
+  std::uint32_t intern(std::string_view s);
+  std::string_view name(std::uint32_t id) const { return names[id]; }
+};
+
+// Parse tree flattened into parallel arrays in post-order, in the order the
+// parser creates the nodes: every node comes after all of its descendants,
+// so the subtree of node i is the contiguous range [subtreeBegin(i), i].
+// The children of node i are childIds[firstChild[i] ...] (childCount[i]
+// of them) and it covers tokens[firstToken[i] .. endToken[i]).
+struct ParseTree {
+  // TokenKind of a leaf, grammar symbol id of a nonterminal
+  std::vector<std::uint8_t> symbol;
+  // grammar rule a nonterminal was reduced by (0 for leaves)
+  std::vector<std::uint8_t> rule;
+  std::vector<std::uint32_t> firstChild;
+  std::vector<std::uint8_t> childCount;
+  std::vector<std::uint32_t> firstToken;
+  std::vector<std::uint32_t> endToken;
+  // set once the node has been annotated
+  std::vector<ValueType> type;
+
+  std::vector<std::uint32_t> childIds;
+  std::vector<Token> tokens;
+
+  // Appends a leaf for t and returns its id
+  std::uint32_t addLeaf(const Token &t);
+  // Appends a node reduced by rule over the given children; returns its id
+  std::uint32_t addNode(int rule, const std::uint32_t *children,
+                        std::size_t count);
+
+  std::uint32_t size() const { return symbol.size(); }
+  std::uint32_t subtreeBegin(std::uint32_t id) const;
+  // bytes held by the arrays, for --stats
+  std::size_t bytesUsed() const;
 };
 
-// Node in the abstract syntax tree containing parsing information
+// Handle to one node of a ParseTree. Handles are passed by value; a
+// default-constructed handle is null and tests false.
 struct Treenode {
-  bool terminal;
-  Rule NTrule;
-  Token Ttoken;
-  std::string type;
-  std::vector<std::shared_ptr<Treenode>> children;
+  ParseTree *tree = nullptr;
+  std::uint32_t id = 0;
 
-  Treenode(Rule NTrule);
-  Treenode(Token Ttoken);
-  ~Treenode();
+  explicit operator bool() const { return tree != nullptr; }
+  bool terminal() const { return tree->symbol[id] < TK_COUNT; }
+  // TokenKind of a leaf, grammar symbol id (Nonterminal) otherwise
+  int symbol() const { return tree->symbol[id]; }
+  // Production (see wlp4data.h) a nonterminal was reduced by
+  int production() const { return tree->rule[id]; }
+  // the grammar rule a nonterminal was reduced by
+  const Rule &getRule() const;
+  const Token &token() const { return tree->tokens[tree->firstToken[id]]; }
+  ValueType type() const { return tree->type[id]; }
+  void setType(ValueType t) const { tree->type[id] = t; }
 
-  std::shared_ptr<Treenode> getChild(std::string lhs, int n = 1);
-  void annotateTypes(ProcedureTable &pt, VariableTable &vt);
-  void print(std::ostream &out = std::cout, std::string prefix = "");
-  void debugPrint(std::ostream &out = std::cout, std::string prefix = "");
+  std::size_t childCount() const { return tree->childCount[id]; }
+  Treenode child(std::size_t i) const {
+    return Treenode{tree, tree->childIds[tree->firstChild[id] + i]};
+  }
+  void print(std::ostream &out = std::cout) const;
+  void debugPrint(std::ostream &out = std::cout,
+                  std::string prefix = "") const;
 };
 
-// Represents a variable entry in the symbol table
+// Represents a variable entry in the symbol table. id is the interned
+// symbol id of the name (Token::id).
 struct Variable {
-  std::string name;
-  std::string type;
-  Variable(std::shared_ptr<Treenode> tree);
-  void print(std::ostream &out = std::cout);
+  std::uint32_t id;
+  std::string_view name;
+  ValueType type;
+  Variable(Treenode tree);
+  void print(std::ostream &out = std::cout) const;
 };
 
-// Table storing all variables in a particular scope
+// Table storing all variables in a particular scope, in declaration order.
+// slots maps a symbol id to its index in variables.
 struct VariableTable {
-  std::map<std::string, Variable> table;
-  void add(Variable v);
-  Variable get(std::string name);
-  void print(std::ostream &out = std::cout);
+  std::vector<Variable> variables;
+  std::unordered_map<std::uint32_t, std::uint32_t> slots;
+  void add(const Variable &v);
+  bool contains(std::uint32_t id) const { return slots.count(id) != 0; }
+  const Variable &get(std::uint32_t id) const;
+  void print(std::ostream &out = std::cout) const;
 };
 
 // Represents a procedure/function with its signature and symbol table
 struct Procedure {
-  std::string name;
-  std::vector<std::string> signature;
+  std::uint32_t id = 0;
+  std::string_view name;
+  Signature signature;
   VariableTable symbolTable;
-  Procedure(std::shared_ptr<Treenode> tree);
-  void print(std::ostream &out = std::cout);
+  void print(std::ostream &out = std::cout) const;
 };
 
-// Table storing all procedures in the program
+// Table storing all procedures in the program, in declaration order.
+// slots is indexed directly by symbol id and holds the procedure's index
+// plus one (0 for names that are not procedures).
 struct ProcedureTable {
-  std::map<std::string, Procedure> table;
-  void add(Procedure p);
-  Procedure get(std::string name);
-  void print(std::ostream &out = std::cout);
+  std::vector<Procedure> procedures;
+  std::vector<std::uint32_t> slots;
+  const Procedure &add(Procedure p);
+  const Procedure &get(std::uint32_t id) const;
+  void print(std::ostream &out = std::cout) const;
+};
+
+// Assembly generated for one procedure (or main) independently of the
+// others, to be written out in source order
+struct ProcedureCode {
+  Treenode procedure;
+  std::string text;
+  // set if generation stopped with a runtime_error; text holds the code
+  // emitted before it
+  bool failed = false;
+  std::string error;
+};
+
+// State of code generation for one procedure. Code is written to out.
+// Labels are numbered per procedure, and procedure is the index of the
+// procedure in the program, so procedures generated on different threads
+// never need to agree on names.
+struct CodeContext {
+  Emitter &out;
+  const ProcedureTable &pt;
+  int procedure = 0;
+  int labelCount = 0;
+  // write the IR of the procedure instead of its code (--emit=ir)
+  bool emitIr = false;
+};
+
+// Semantic analysis fused into parsing. The parser reports every shift and
+// every reduction, and each node is declared, typed and checked as soon as
+// it is built. Errors are ranked by the pass that used to find them, so the
+// first error of the first failing procedure is still the one reported.
+struct SemanticAnalyzer {
+  enum ErrorRank {
+    NO_ERROR,
+    RANK_INITIALIZER,
+    RANK_MAIN_PARAMETER,
+    RANK_DUPLICATE_VARIABLE,
+    RANK_DUPLICATE_PROCEDURE,
+    RANK_TYPE,
+    RANK_STATEMENT,
+    RANK_RETURN
+  };
+
+  ProcedureTable pt;
+  // state of the procedure being parsed; its name is the first identifier
+  // (or WAIN) shifted since the previous procedure was reduced
+  Token name{};
+  bool named = false;
+  bool inParams = true;
+  Signature signature;
+  VariableTable vars;
+  ErrorRank errorRank = NO_ERROR;
+  std::string error;
+  // set once a procedure has been reduced with an error; nothing after it is
+  // analyzed
+  bool failed = false;
+
+  void shifted(const Token &t);
+  void reduced(Treenode node);
+
+private:
+  void report(ErrorRank rank, const char *message);
+  void beginBody();
+  void endProcedure(Treenode node);
 };
 
 #endif // STRUCTURES_H
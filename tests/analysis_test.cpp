@@ -0,0 +1,236 @@
+// Unit checks of the IR analyses in cfg.h on hand-built procedures
+#include "cfg.h"
+#include <initializer_list>
+#include <iostream>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition "\n";        \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (false)
+
+// Builds a procedure block by block; vregs below variables are variables
+struct Builder {
+  IrProcedure ir;
+
+  explicit Builder(int variables) {
+    ir.variables = variables;
+    ir.vregs = variables;
+    ir.inMemory.assign(variables, false);
+  }
+  std::int32_t temporary() { return ir.vregs++; }
+  void add(IrOp op, std::int32_t dst = NO_VREG, std::int32_t a = NO_VREG,
+           std::int32_t b = NO_VREG, std::int32_t imm = 0) {
+    ir.code.push_back({op, dst, a, b, imm});
+  }
+  // ends the current block with a terminator
+  void jump(std::int32_t target) {
+    add(IR_JUMP);
+    end(target, -1);
+  }
+  void branch(std::int32_t test, std::int32_t taken, std::int32_t other) {
+    add(IR_BRANCH, NO_VREG, test);
+    end(taken, other);
+  }
+  void ret(std::int32_t value) {
+    add(IR_RET, NO_VREG, value);
+    end(-1, -1);
+  }
+  void end(std::int32_t first, std::int32_t second) {
+    IrBlock block;
+    block.begin = ir.blocks.empty() ? 0 : ir.blocks.back().end;
+    block.end = ir.code.size();
+    block.successors[0] = first;
+    block.successors[1] = second;
+    ir.blocks.push_back(block);
+  }
+};
+
+bool predecessorsAre(const ControlFlowGraph &cfg, int block,
+                     std::initializer_list<int> expected) {
+  std::uint32_t begin = cfg.predecessorBegin[block];
+  if (cfg.predecessorBegin[block + 1] - begin != expected.size()) {
+    return false;
+  }
+  for (int p : expected) {
+    bool found = false;
+    for (std::uint32_t i = begin; i < cfg.predecessorBegin[block + 1]; ++i) {
+      found = found || cfg.predecessors[i] == p;
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool liveIn(const Liveness &live, int block, std::initializer_list<int> vars,
+            int variables) {
+  for (int v = 0; v < variables; ++v) {
+    bool expected = false;
+    for (int e : vars) {
+      expected = expected || e == v;
+    }
+    if (Liveness::contains(live.in(block), v) != expected) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// B0 -> B1 | B2 -> B3
+void diamond() {
+  Builder b(1);
+  std::int32_t x = 0;
+  b.add(IR_CONST, x);
+  b.branch(x, 1, 2);
+  b.add(IR_CONST, x);
+  b.jump(3);
+  b.jump(3);
+  b.ret(x);
+
+  const ControlFlowGraph &cfg = controlFlow(b.ir);
+  CHECK(predecessorsAre(cfg, 0, {}));
+  CHECK(predecessorsAre(cfg, 1, {0}));
+  CHECK(predecessorsAre(cfg, 3, {1, 2}));
+  CHECK(cfg.reversePostorder.size() == 4);
+  CHECK(cfg.reversePostorder.front() == 0);
+  CHECK(cfg.reversePostorder.back() == 3);
+
+  const DominatorTree &dom = dominators(b.ir);
+  CHECK(dom.idom[0] == 0);
+  CHECK(dom.idom[1] == 0);
+  CHECK(dom.idom[2] == 0);
+  CHECK(dom.idom[3] == 0);
+  CHECK(dom.dominates(0, 3));
+  CHECK(dom.dominates(3, 3));
+  CHECK(!dom.dominates(1, 3));
+  CHECK(!dom.dominates(3, 0));
+
+  const Liveness &live = liveness(b.ir);
+  CHECK(liveIn(live, 0, {}, 1));
+  CHECK(liveIn(live, 1, {}, 1));
+  CHECK(liveIn(live, 2, {x}, 1));
+  CHECK(liveIn(live, 3, {x}, 1));
+
+  const LoopNest &nest = loops(b.ir);
+  for (int block = 0; block < 4; ++block) {
+    CHECK(nest.depth[block] == 0);
+  }
+}
+
+// B0 -> B1 (outer header) -> B2 (inner header) -> B3 -> B2, B2 -> B4 -> B1,
+// B1 -> B5. Variable 70 is defined first and used last, so it is live
+// through the loops in the second word of each set.
+void nestedLoops() {
+  Builder b(72);
+  std::int32_t i = 0, j = 1, n = 2, far = 70, memory = 71;
+  b.ir.inMemory[memory] = true;
+  b.add(IR_CONST, i);
+  b.add(IR_CONST, n);
+  b.add(IR_CONST, far);
+  b.add(IR_STORE_VAR, NO_VREG, i, NO_VREG, memory);
+  b.jump(1);
+  std::int32_t outer = b.temporary();
+  b.add(IR_LT, outer, i, n);
+  b.branch(outer, 2, 5);
+  std::int32_t inner = b.temporary();
+  b.add(IR_LT, inner, j, n);
+  b.branch(inner, 3, 4);
+  b.add(IR_ADD, j, j, i);
+  b.jump(2);
+  b.add(IR_ADD, i, i, n);
+  b.add(IR_CONST, j);
+  b.jump(1);
+  b.add(IR_LOAD_VAR, b.temporary(), NO_VREG, NO_VREG, memory);
+  b.ret(far);
+
+  const DominatorTree &dom = dominators(b.ir);
+  CHECK(dom.idom[1] == 0);
+  CHECK(dom.idom[2] == 1);
+  CHECK(dom.idom[3] == 2);
+  CHECK(dom.idom[4] == 2);
+  CHECK(dom.idom[5] == 1);
+  CHECK(dom.dominates(1, 4));
+  CHECK(!dom.dominates(3, 4));
+
+  const LoopNest &nest = loops(b.ir);
+  CHECK(nest.depth[0] == 0);
+  CHECK(nest.depth[1] == 1);
+  CHECK(nest.depth[2] == 2);
+  CHECK(nest.depth[3] == 2);
+  CHECK(nest.depth[4] == 1);
+  CHECK(nest.depth[5] == 0);
+
+  // j is read in the inner header before the outer loop has set it, so it
+  // is live on entry; the variable in memory is never tracked
+  const Liveness &live = liveness(b.ir);
+  CHECK(live.words == 2);
+  CHECK(liveIn(live, 0, {j}, 72));
+  CHECK(liveIn(live, 1, {i, j, n, far}, 72));
+  CHECK(liveIn(live, 3, {i, j, n, far}, 72));
+  CHECK(liveIn(live, 4, {i, n, far}, 72));
+  CHECK(liveIn(live, 5, {far}, 72));
+  CHECK(Liveness::contains(live.out(4), far));
+  CHECK(!Liveness::contains(live.out(5), far));
+}
+
+// B1 is never reached
+void unreachable() {
+  Builder b(1);
+  b.add(IR_CONST, 0);
+  b.jump(2);
+  b.jump(2);
+  b.ret(0);
+
+  const ControlFlowGraph &cfg = controlFlow(b.ir);
+  CHECK(cfg.reachable(0));
+  CHECK(!cfg.reachable(1));
+  CHECK(cfg.reachable(2));
+  CHECK(predecessorsAre(cfg, 2, {0, 1}));
+
+  const DominatorTree &dom = dominators(b.ir);
+  CHECK(dom.idom[1] == -1);
+  CHECK(dom.idom[2] == 0);
+  CHECK(!dom.dominates(1, 2));
+  CHECK(!dom.dominates(0, 1));
+}
+
+// results are cached until invalidated
+void caching() {
+  Builder b(1);
+  b.add(IR_CONST, 0);
+  b.jump(1);
+  b.ret(0);
+
+  const Liveness *first = &liveness(b.ir);
+  CHECK(&liveness(b.ir) == first);
+  CHECK(liveIn(*first, 1, {0}, 1));
+
+  // make block 1 define the variable before returning it
+  b.ir.code.insert(b.ir.code.begin() + 2, {IR_CONST, 0, NO_VREG, NO_VREG, 1});
+  ++b.ir.blocks[1].end;
+  invalidateAnalyses(b.ir);
+  CHECK(liveIn(liveness(b.ir), 1, {}, 1));
+}
+
+} // namespace
+
+int main() {
+  diamond();
+  nestedLoops();
+  unreachable();
+  caching();
+  if (failures != 0) {
+    std::cerr << failures << " analysis checks failed\n";
+    return 1;
+  }
+  std::cout << "analysis checks passed\n";
+  return 0;
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+# Differential test: generates small WLP4 programs that are mostly
+# ill-typed (mixed int and int* names, calls to undeclared or mismatched
+# procedures, duplicate declarations) and checks that two compilers give
+# the same diagnostics for each. It then counts the programs by the second
+# compiler's diagnostic.
+#
+# usage: fuzz_diagnostics.py seed count compiler_a compiler_b
+import os, random, shlex, subprocess, sys, tempfile
+
+R = random.Random(int(sys.argv[1]))
+NAMES = ['a', 'b', 'c', 'p', 'q']
+PROCS = ['f', 'g', 'h']
+
+def ty():
+    return R.choice(['int', 'int*'])
+
+def expr(d=0):
+    r = R.random()
+    if d > 2 or r < 0.3:
+        return R.choice(NAMES + ['1', 'NULL', '2'])
+    if r < 0.45:
+        return '&' + R.choice(NAMES)
+    if r < 0.55:
+        return '*' + expr(d + 1)
+    if r < 0.65:
+        return 'new int[' + expr(d + 1) + ']'
+    if r < 0.8:
+        return expr(d + 1) + R.choice([' + ', ' - ', ' * ', ' / ']) + expr(d + 1)
+    if r < 0.9:
+        return R.choice(PROCS + NAMES) + '()'
+    args = (expr(d + 1) for _ in range(R.randint(1, 3)))
+    return R.choice(PROCS + NAMES) + '(' + ', '.join(args) + ')'
+
+def stmt(d=0):
+    r = R.random()
+    if r < 0.4:
+        return R.choice(NAMES + ['*' + expr(1)]) + ' = ' + expr() + ';'
+    if r < 0.55:
+        return 'println(' + expr() + ');'
+    if r < 0.65:
+        return 'delete [] ' + expr() + ';'
+    test = expr() + R.choice([' < ', ' == ', ' != ']) + expr()
+    if r < 0.8 and d < 2:
+        return 'if (' + test + ') {' + stmt(d + 1) + '} else {' + stmt(d + 1) + '}'
+    if d < 2:
+        return 'while (' + test + ') {' + stmt(d + 1) + '}'
+    return 'println(1);'
+
+def dcls():
+    out = []
+    for _ in range(R.randint(0, 3)):
+        t = ty()
+        if R.random() < 0.2:
+            init = R.choice(['NULL', '0'])
+        else:
+            init = '0' if t == 'int' else 'NULL'
+        out.append('%s %s = %s;' % (t, R.choice(NAMES), init))
+    return ' '.join(out)
+
+def body():
+    stmts = ' '.join(stmt() for _ in range(R.randint(0, 3)))
+    return dcls() + ' ' + stmts + ' return ' + expr() + ';'
+
+def program():
+    procs = []
+    for _ in range(R.randint(0, 2)):
+        params = ', '.join('%s %s' % (ty(), R.choice(NAMES))
+                           for _ in range(R.randint(0, 2)))
+        procs.append('int %s(%s) { %s }' % (R.choice(PROCS), params, body()))
+    procs.append('int wain(%s a, %s b) { %s }' % (ty(), ty(), body()))
+    return '\n'.join(procs)
+
+def main():
+    count = int(sys.argv[2])
+    compilers = [shlex.split(c) for c in sys.argv[3:5]]
+    diffs = 0
+    kinds = {}
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 't.wlp4')
+        for _ in range(count):
+            source = program()
+            open(path, 'w').write(source)
+            outs = [subprocess.run(c + [path], capture_output=True, text=True)
+                    for c in compilers]
+            kind = outs[1].stderr.strip()[:60]
+            kinds[kind] = kinds.get(kind, 0) + 1
+            if outs[0].stderr != outs[1].stderr:
+                diffs += 1
+                if diffs <= 3:
+                    print('DIFF', source, outs[0].stderr, outs[1].stderr,
+                          sep='\n')
+    print('diffs', diffs, 'of', count)
+    for kind, n in sorted(kinds.items(), key=lambda k: -k[1]):
+        print(n, kind or '(compiled)')
+    sys.exit(1 if diffs else 0)
+
+main()
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+# Differential test: generates well-typed WLP4 programs (procedures with
+# int and pointer parameters, recursion, new/delete, address-of, nested if
+# and while) and checks that two compilers produce the same output and
+# diagnostics for each. A compiler may carry options, e.g. "./main
+# --threads 3". The first differences are printed with their program.
+#
+# With --run, the two outputs are run on the emulator instead and their
+# println output, result and emulator errors compared, for compilers that
+# generate different code. --no-addresses leaves out address-of, whose
+# values depend on the frame layout.
+#
+# usage: fuzz_programs.py [--run] [--no-addresses] seed count compiler_a
+#                         compiler_b
+import argparse, os, random, shlex, subprocess, sys, tempfile
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--run', action='store_true')
+parser.add_argument('--no-addresses', action='store_true')
+parser.add_argument('seed', type=int)
+parser.add_argument('count', type=int)
+parser.add_argument('compilers', nargs=2)
+ARGS = parser.parse_args()
+R = random.Random(ARGS.seed)
+EMULATOR = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'mips.py')
+
+def program():
+    procs = []  # (name, [parameter types])
+    out = []
+
+    def body(params):
+        ints = [n for n, t in params if t == 'int']
+        ptrs = [n for n, t in params if t == 'int*']
+        dcls = []
+        for i in range(R.randint(0, 4)):
+            n = 'v%d' % i
+            if R.random() < 0.6:
+                ints.append(n)
+                dcls.append('int %s = %d;' % (n, R.randint(-5, 50)))
+            else:
+                ptrs.append(n)
+                dcls.append('int* %s = NULL;' % n)
+
+        def ie(d=0):
+            r = R.random()
+            if d > 3 or r < 0.25:
+                if ints and R.random() < 0.7:
+                    return R.choice(ints)
+                return str(R.randint(0, 99))
+            if r < 0.55:
+                op = R.choice([' + ', ' - ', ' * ', ' / ', ' % '])
+                return '(' + ie(d + 1) + op + ie(d + 1) + ')'
+            if r < 0.62 and ptrs:
+                return '(' + pe(d + 1) + ' - ' + pe(d + 1) + ')'
+            if r < 0.7 and ptrs:
+                return '*' + R.choice(ptrs)
+            if r < 0.85 and procs:
+                name, sig = R.choice(procs)
+                args = (ie(d + 1) if t == 'int' else pe(d + 1) for t in sig)
+                return '%s(%s)' % (name, ', '.join(args))
+            return ie(d + 1) + ' + ' + ie(d + 1)
+
+        def pe(d=0):
+            r = R.random()
+            if d > 3 or r < 0.3:
+                if ptrs and R.random() < 0.7:
+                    return R.choice(ptrs)
+                if ints and not ARGS.no_addresses:
+                    return '&' + R.choice(ints)
+                return 'NULL'
+            if r < 0.5:
+                return '(' + pe(d + 1) + R.choice([' + ', ' - ']) + ie(d + 1) + ')'
+            if r < 0.6:
+                return '(' + ie(d + 1) + ' + ' + pe(d + 1) + ')'
+            if r < 0.75:
+                return 'new int[' + ie(d + 1) + ']'
+            if r < 0.85 and ints and not ARGS.no_addresses:
+                return '&(' + R.choice(ints) + ')'
+            return pe(d + 1)
+
+        def test():
+            op = R.choice(['<', '<=', '>', '>=', '==', '!='])
+            if ptrs and R.random() < 0.3:
+                return pe() + ' ' + op + ' ' + pe()
+            return ie() + ' ' + op + ' ' + ie()
+
+        def block(d):
+            return ' '.join(st(d + 1) for _ in range(R.randint(0, 2)))
+
+        def st(d=0):
+            r = R.random()
+            if r < 0.3 and ints:
+                return R.choice(ints) + ' = ' + ie() + ';'
+            if r < 0.4 and ptrs:
+                return R.choice(ptrs) + ' = ' + pe() + ';'
+            if r < 0.45 and ptrs:
+                return '*' + R.choice(ptrs) + ' = ' + ie() + ';'
+            if r < 0.6:
+                return 'println(' + ie() + ');'
+            if r < 0.65 and ptrs:
+                return 'delete [] ' + R.choice(ptrs) + ';'
+            if r < 0.82 and d < 3:
+                return ('if (' + test() + ') {' + block(d) + '} else {' +
+                        block(d) + '}')
+            if d < 3:
+                return 'while (' + test() + ') {' + block(d) + '}'
+            return 'println(0);'
+
+        stmts = [st() for _ in range(R.randint(0, 5))]
+        return (' '.join(dcls) + '\n  ' + '\n  '.join(stmts) +
+                '\n  return ' + ie() + ';')
+
+    for k in range(R.randint(0, 3)):
+        name = R.choice(['f', 'g', 'h', 'print', 'init', 'main', 'new1',
+                         'p%d' % k])
+        if any(name == p[0] for p in procs):
+            continue
+        sig = [R.choice(['int', 'int', 'int*']) for _ in range(R.randint(0, 3))]
+        params = [('a%d' % i, t) for i, t in enumerate(sig)]
+        procs.append((name, sig))  # before the body, so it may recurse
+        out.append('int %s(%s) {\n  %s\n}' % (
+            name, ', '.join('%s %s' % (t, n) for n, t in params), body(params)))
+    first = R.choice(['int', 'int*'])
+    out.append('int wain(%s a, int b) {\n  %s\n}' % (
+        first, body([('a', first), ('b', 'int')])))
+    return '\n'.join(out)
+
+# what the emulator makes of a compiled program: its output and result, or
+# the error it stopped with. Older builds exit with 0 on errors, so any
+# diagnostics mean the program was rejected.
+def run(tmp, index, source, compiled):
+    if compiled.returncode != 0 or compiled.stderr:
+        return ('rejected', compiled.stderr)
+    asm = os.path.join(tmp, 'p%d.asm' % index)
+    open(asm, 'w').write(compiled.stdout)
+    if 'wain(int* a' in source:
+        args = ['--array', '3', '1', '4']
+    else:
+        args = ['7', '3']
+    env = dict(os.environ, MIPS_STEPS='200000')
+    r = subprocess.run(['python3', EMULATOR, asm] + args,
+                       capture_output=True, text=True, env=env)
+    error = r.stderr.splitlines()[-1:] if r.returncode else []
+    return (r.stdout, r.returncode, error)
+
+def main():
+    compilers = [shlex.split(c) for c in ARGS.compilers]
+    diffs = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'p.wlp4')
+        for _ in range(ARGS.count):
+            source = program()
+            open(path, 'w').write(source)
+            outs = [subprocess.run(c + [path], capture_output=True, text=True)
+                    for c in compilers]
+            if ARGS.run:
+                results = [run(tmp, i, source, o) for i, o in enumerate(outs)]
+            else:
+                results = [(o.returncode, o.stdout, o.stderr) for o in outs]
+            if results[0] != results[1]:
+                diffs += 1
+                if diffs <= 3:
+                    print('DIFF\n' + source + '\n' + repr(results))
+    print('diffs', diffs, 'of', ARGS.count)
+    sys.exit(1 if diffs else 0)
+
+main()
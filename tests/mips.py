@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+# MIPS emulator for the compiler's output, for the regression tests. It runs
+# the CS241 subset the code generator emits, with print, init, new and
+# delete built in (they change no register but $3), and prints the println
+# output followed by $3. Counts of steps, loads and stores go to stderr.
+#
+# usage: mips.py asmfile a b               (wain(int, int))
+#        mips.py asmfile --array v1 v2 ..  (wain(int*, int))
+# MIPS_STEPS bounds the number of instructions run (default 50000000).
+import os, re, sys
+
+M32 = 0xFFFFFFFF
+def s32(x):
+    x &= M32
+    return x - (1 << 32) if x & 0x80000000 else x
+
+def main():
+    path = sys.argv[1]
+    args = sys.argv[2:]
+    lines = open(path).read().split('\n')
+    # skip token dump
+    start = 0
+    for i, l in enumerate(lines):
+        if l.startswith('.import'):
+            start = i
+            break
+    prog = []  # list of (op, operands)
+    labels = {}
+    imports = {'print': -1, 'init': -2, 'new': -3, 'delete': -4}
+    for l in lines[start:]:
+        l = l.split(';')[0].strip()
+        while True:
+            m = re.match(r'^([A-Za-z_][A-Za-z0-9_]*):\s*(.*)$', l)
+            if not m: break
+            if m.group(1) in labels: raise SystemExit('dup label ' + m.group(1))
+            labels[m.group(1)] = len(prog) * 4
+            l = m.group(2).strip()
+        if not l or l.startswith('.import'): continue
+        parts = l.replace(',', ' ').split()
+        prog.append((parts[0], parts[1:]))
+    reg = [0] * 32
+    mem = {}
+    heap_next = 0x100000
+    allocs = {}
+    if args and args[0] == '--array':
+        vals = [int(v) for v in args[1:]]
+        base = 0x80000
+        for i, v in enumerate(vals):
+            mem[base + 4 * i] = v & M32
+        reg[1], reg[2] = base, len(vals)
+    else:
+        reg[1], reg[2] = int(args[0]) & M32, int(args[1]) & M32
+    reg[30] = 0x1000000
+    reg[31] = 0x8123456c
+    hi = lo = 0
+    pc = 0
+    out = []
+    steps = 0
+    loads = stores = 0
+    max_steps = int(os.environ.get('MIPS_STEPS', '50000000'))
+    def val(tok):
+        if tok in labels: return labels[tok]
+        if tok in imports: return imports[tok] & M32
+        return int(tok, 0) & M32
+    def r(tok):
+        assert tok[0] == '$', tok
+        return int(tok[1:])
+    while True:
+        if pc == 0x8123456c:
+            break
+        if pc & M32 in (imports['print'] & M32, imports['init'] & M32, imports['new'] & M32, imports['delete'] & M32):
+            p = s32(pc)
+            if p == -1:
+                out.append(str(s32(reg[1])))
+            elif p == -2:
+                pass
+            elif p == -3:
+                n = s32(reg[1])
+                if n <= 0: reg[3] = 0
+                else:
+                    reg[3] = heap_next
+                    allocs[heap_next] = n
+                    heap_next += 4 * n + 8
+            elif p == -4:
+                a = reg[1]
+                if a not in allocs: raise SystemExit('bad delete %x' % a)
+                del allocs[a]
+            pc = reg[31]
+            continue
+        if pc % 4 or pc // 4 >= len(prog) or pc < 0:
+            raise SystemExit('bad pc %x' % pc)
+        op, o = prog[pc // 4]
+        pc += 4
+        steps += 1
+        if steps > max_steps: raise SystemExit('too many steps')
+        def setr(d, v):
+            if d != 0: reg[d] = v & M32
+        if op == 'add': setr(r(o[0]), reg[r(o[1])] + reg[r(o[2])])
+        elif op == 'sub': setr(r(o[0]), reg[r(o[1])] - reg[r(o[2])])
+        elif op == 'slt': setr(r(o[0]), 1 if s32(reg[r(o[1])]) < s32(reg[r(o[2])]) else 0)
+        elif op == 'sltu': setr(r(o[0]), 1 if reg[r(o[1])] < reg[r(o[2])] else 0)
+        elif op in ('mult', 'multu'):
+            a, b = reg[r(o[0])], reg[r(o[1])]
+            if op == 'mult': a, b = s32(a), s32(b)
+            p = (a * b) & 0xFFFFFFFFFFFFFFFF
+            lo, hi = p & M32, (p >> 32) & M32
+        elif op in ('div', 'divu'):
+            a, b = reg[r(o[0])], reg[r(o[1])]
+            if op == 'div': a, b = s32(a), s32(b)
+            if b == 0: raise SystemExit('div by zero')
+            q = abs(a) // abs(b)
+            if (a < 0) != (b < 0): q = -q
+            lo, hi = q & M32, (a - q * b) & M32
+        elif op == 'mfhi': setr(r(o[0]), hi)
+        elif op == 'mflo': setr(r(o[0]), lo)
+        elif op == 'lis':
+            op2, o2 = prog[pc // 4]
+            assert op2 == '.word'
+            setr(r(o[0]), val(o2[0]))
+            pc += 4
+        elif op == '.word': raise SystemExit('executed .word')
+        elif op in ('lw', 'sw'):
+            m = re.match(r'^(-?\w+)\((\$\d+)\)$', o[1])
+            offset = int(m.group(1), 0)
+            if not -32768 <= offset <= 32767:
+                raise SystemExit('offset out of range: ' + o[1])
+            addr = (reg[r(m.group(2))] + offset) & M32
+            if addr % 4: raise SystemExit('unaligned %x' % addr)
+            if op == 'lw':
+                loads += 1
+                setr(r(o[0]), mem.get(addr, 0))
+            else:
+                stores += 1
+                mem[addr] = reg[r(o[0])]
+        elif op in ('beq', 'bne'):
+            eq = reg[r(o[0])] == reg[r(o[1])]
+            if (op == 'beq') == eq:
+                t = o[2]
+                if t in labels: pc = labels[t]
+                else: pc += 4 * int(t, 0)
+        elif op == 'jr': pc = reg[r(o[0])]
+        elif op == 'jalr':
+            t = reg[r(o[0])]
+            reg[31] = pc
+            pc = t
+        else:
+            raise SystemExit('unknown op ' + op)
+    for x in out: print(x)
+    print('$3 =', s32(reg[3]))
+    sys.stderr.write('steps=%d loads=%d stores=%d\n' % (steps, loads, stores))
+
+main()
@@ -0,0 +1,277 @@
+// Unit checks of the register allocator on hand-built procedures
+#include "regalloc.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition "\n";        \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (false)
+
+// Builds a procedure block by block; vregs below variables are variables
+struct Builder {
+  IrProcedure ir;
+
+  explicit Builder(int variables) {
+    ir.variables = variables;
+    ir.vregs = variables;
+    ir.inMemory.assign(variables, false);
+  }
+  std::int32_t temporary() { return ir.vregs++; }
+  void add(IrOp op, std::int32_t dst = NO_VREG, std::int32_t a = NO_VREG,
+           std::int32_t b = NO_VREG, std::int32_t imm = 0) {
+    ir.code.push_back({op, dst, a, b, imm});
+  }
+  std::int32_t constant() {
+    std::int32_t t = temporary();
+    add(IR_CONST, t);
+    return t;
+  }
+  std::int32_t sum(std::int32_t a, std::int32_t b) {
+    std::int32_t t = temporary();
+    add(IR_ADD, t, a, b);
+    return t;
+  }
+  std::int32_t call(std::int32_t arg) {
+    std::int32_t t = temporary();
+    add(IR_CALL, t, ir.args.size(), 1);
+    ir.args.push_back(arg);
+    return t;
+  }
+  // ends the current block with a terminator
+  void jump(std::int32_t target) {
+    add(IR_JUMP);
+    end(target, -1);
+  }
+  void branch(std::int32_t test, std::int32_t taken, std::int32_t other) {
+    add(IR_BRANCH, NO_VREG, test);
+    end(taken, other);
+  }
+  void ret(std::int32_t value) {
+    add(IR_RET, NO_VREG, value);
+    end(-1, -1);
+  }
+  void end(std::int32_t first, std::int32_t second) {
+    IrBlock block;
+    block.begin = ir.blocks.empty() ? 0 : ir.blocks.back().end;
+    block.end = ir.code.size();
+    block.successors[0] = first;
+    block.successors[1] = second;
+    ir.blocks.push_back(block);
+  }
+};
+
+// Checks an allocation of a single block: every vreg that occurs gets a
+// register or a slot, and no register or slot holds two values at once.
+// Positions are those of the allocator, 2i for the operands of instruction
+// i and 2i + 1 for its result.
+void checkStraightLine(const IrProcedure &ir,
+                       const RegisterAllocation &allocation,
+                       int registerCount) {
+  std::vector<std::uint32_t> start(ir.vregs, UINT32_MAX), end(ir.vregs, 0);
+  auto extend = [&](std::int32_t v, std::uint32_t position) {
+    start[v] = std::min(start[v], position);
+    end[v] = std::max(end[v], position);
+  };
+  for (std::uint32_t i = 0; i < ir.code.size(); ++i) {
+    forEachUse(ir, ir.code[i], [&](std::int32_t v) { extend(v, 2 * i); });
+    if (ir.code[i].dst != NO_VREG) {
+      extend(ir.code[i].dst, 2 * i + 1);
+    }
+  }
+  // [first, last] positions in which a vreg holds its register or slot
+  struct Range {
+    std::uint32_t first, last;
+  };
+  std::vector<Range> inRegister(ir.vregs, {1, 0}), inSlot(ir.vregs, {1, 0});
+  for (std::int32_t v = 0; v < ir.vregs; ++v) {
+    if (start[v] == UINT32_MAX) {
+      continue;
+    }
+    std::int8_t r = allocation.registers[v];
+    std::uint32_t split = allocation.splitAt[v];
+    CHECK(r == NO_REGISTER || (r >= FIRST_ALLOCATABLE_REGISTER &&
+                               r < FIRST_ALLOCATABLE_REGISTER + registerCount));
+    if (r == NO_REGISTER) {
+      inSlot[v] = {start[v], end[v]};
+    } else if (split == NO_SPLIT) {
+      inRegister[v] = {start[v], end[v]};
+    } else {
+      CHECK(start[v] < 2 * split && 2 * split <= end[v]);
+      inRegister[v] = {start[v], 2 * split - 1};
+      inSlot[v] = {2 * split, end[v]};
+    }
+    if (inSlot[v].first <= inSlot[v].last) {
+      CHECK(allocation.frameSlots[v] >= 0 &&
+            allocation.frameSlots[v] < allocation.frameWords);
+    }
+  }
+  auto overlap = [](Range a, Range b) {
+    return a.first <= a.last && b.first <= b.last && a.first <= b.last &&
+           b.first <= a.last;
+  };
+  for (std::int32_t v = 0; v < ir.vregs; ++v) {
+    for (std::int32_t w = v + 1; w < ir.vregs; ++w) {
+      if (allocation.registers[v] == allocation.registers[w]) {
+        CHECK(!overlap(inRegister[v], inRegister[w]));
+      }
+      if (allocation.frameSlots[v] == allocation.frameSlots[w]) {
+        CHECK(!overlap(inSlot[v], inSlot[w]));
+      }
+    }
+  }
+}
+
+// a balanced sum of eight constants needs four registers at its widest
+void pressure() {
+  Builder b(0);
+  std::vector<std::int32_t> values;
+  for (int k = 0; k < 8; ++k) {
+    values.push_back(b.constant());
+  }
+  for (std::size_t width = 8; width > 1; width /= 2) {
+    for (std::size_t k = 0; k < width / 2; ++k) {
+      values[k] = b.sum(values[2 * k], values[2 * k + 1]);
+    }
+  }
+  b.ret(values[0]);
+
+  for (int count : {0, 1, 2, 3, 8, ALLOCATABLE_REGISTERS}) {
+    RegisterAllocation allocation = allocateRegisters(b.ir, count);
+    checkStraightLine(b.ir, allocation, count);
+    CHECK(allocation.savedAtCalls.empty());
+    if (count >= 8) {
+      CHECK(allocation.frameWords == 0);
+      CHECK(allocation.splits.empty());
+    }
+  }
+}
+
+// without registers, values in the frame at different times share a slot
+void slotReuse() {
+  Builder b(0);
+  std::int32_t left = b.sum(b.constant(), b.constant());
+  std::int32_t right = b.sum(b.constant(), b.constant());
+  b.ret(b.sum(left, right));
+
+  RegisterAllocation allocation = allocateRegisters(b.ir, 0);
+  checkStraightLine(b.ir, allocation, 0);
+  // left, and the two constants of right
+  CHECK(allocation.frameWords == 3);
+}
+
+// a variable defined first and used last gives up its register where the
+// pressure starts and is split there rather than spilled for its lifetime
+void split() {
+  Builder b(1);
+  std::int32_t x = 0;
+  b.add(IR_CONST, x);
+  std::int32_t first = b.constant();
+  b.add(IR_PRINT, NO_VREG, first);
+  std::int32_t sum = b.sum(b.constant(), b.constant());
+  b.add(IR_PRINT, NO_VREG, sum);
+  b.ret(x);
+
+  RegisterAllocation allocation = allocateRegisters(b.ir, 2);
+  checkStraightLine(b.ir, allocation, 2);
+  CHECK(allocation.registers[x] != NO_REGISTER);
+  CHECK(allocation.splitAt[x] != NO_SPLIT);
+  CHECK(allocation.splits == std::vector<std::int32_t>{x});
+  CHECK(allocation.frameSlots[x] == 0);
+  CHECK(allocation.frameWords == 1);
+}
+
+// the accumulator and counter of a loop keep their registers over a
+// variable used more often, but only outside the loop
+void loopWeights() {
+  Builder b(3);
+  std::int32_t s = 0, i = 1, k = 2;
+  b.add(IR_CONST, s);
+  b.add(IR_CONST, i);
+  b.add(IR_CONST, k);
+  for (int use = 0; use < 4; ++use) {
+    b.add(IR_PRINT, NO_VREG, k);
+  }
+  b.jump(1);
+  b.branch(i, 2, 3);
+  b.add(IR_ADD, s, s, i);
+  b.add(IR_SUB, i, i, s);
+  b.jump(1);
+  b.ret(b.sum(s, k));
+
+  RegisterAllocation allocation = allocateRegisters(b.ir, 2);
+  CHECK(allocation.registers[s] != NO_REGISTER);
+  CHECK(allocation.registers[i] != NO_REGISTER);
+  CHECK(allocation.registers[s] != allocation.registers[i]);
+  CHECK(allocation.splitAt[s] == NO_SPLIT);
+  CHECK(allocation.splitAt[i] == NO_SPLIT);
+  CHECK(allocation.registers[k] == NO_REGISTER);
+  CHECK(allocation.frameSlots[k] == 0);
+}
+
+// locals whose address is taken have slots and never registers, and
+// parameters in the frame use the words their caller pushed
+void frameVariables() {
+  Builder b(3);
+  b.ir.params = 1;
+  std::int32_t param = 0, local = 1, addressed = 2;
+  b.ir.inMemory[addressed] = true;
+  b.add(IR_COPY, local, param);
+  std::int32_t address = b.temporary();
+  b.add(IR_ADDR_VAR, address, NO_VREG, NO_VREG, addressed);
+  b.add(IR_STORE, NO_VREG, address, local);
+  b.ret(local);
+
+  RegisterAllocation allocation = allocateRegisters(b.ir, 0);
+  CHECK(allocation.registers[addressed] == NO_REGISTER);
+  CHECK(allocation.frameSlots[addressed] == 0);
+  CHECK(allocation.frameSlots[local] > 0);
+  CHECK(allocation.frameSlots[param] == NO_SLOT);
+
+  allocation = allocateRegisters(b.ir);
+  CHECK(allocation.registers[addressed] == NO_REGISTER);
+  CHECK(allocation.registers[local] != NO_REGISTER);
+  CHECK(allocation.frameWords == 1);
+}
+
+// a call saves the registers of values used after it, but not those of its
+// arguments or its result
+void calls() {
+  Builder b(0);
+  std::int32_t kept = b.constant();
+  std::int32_t argument = b.constant();
+  std::int32_t result = b.call(argument);
+  std::int32_t dropped = b.call(result);
+  b.ret(b.sum(kept, dropped));
+
+  RegisterAllocation allocation = allocateRegisters(b.ir);
+  checkStraightLine(b.ir, allocation, ALLOCATABLE_REGISTERS);
+  std::uint32_t keptBit = std::uint32_t(1) << allocation.registers[kept];
+  CHECK(allocation.savedAtCalls.size() == 2);
+  CHECK(allocation.savedAtCalls[0] == keptBit);
+  CHECK(allocation.savedAtCalls[1] == keptBit);
+}
+
+} // namespace
+
+int main() {
+  pressure();
+  slotReuse();
+  split();
+  loopWeights();
+  frameVariables();
+  calls();
+  if (failures != 0) {
+    std::cerr << failures << " allocation checks failed\n";
+    return 1;
+  }
+  std::cout << "allocation checks passed\n";
+  return 0;
+}
@@ -0,0 +1,53 @@
+#!/bin/sh
+# Regression tests: compiles each program in programs/, runs it on the
+# emulator with the arguments on its "// run:" lines, and compares the
+# output with programs/<name>.expected. The expected outputs are those of
+# the stack-based code generator that preceded the IR and register
+# allocator. Its code for frame uses lw/sw offsets beyond 16 bits, which
+# mips.py rejects, so frame.expected was taken from an emulator without
+# that check; the comments in frame.wlp4 and long.wlp4 work out their
+# results without any compiler.
+# Then compiles each program in diagnostics/ and compares what the compiler
+# reports, followed by its exit status, with diagnostics/<name>.expected.
+#
+# usage: tests/run.sh [compiler]   (default: ./main)
+compiler=${1:-./main}
+dir=$(dirname "$0")
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+failed=0
+for program in "$dir"/programs/*.wlp4; do
+  name=$(basename "$program" .wlp4)
+  if ! "$compiler" "$program" >"$tmp/$name.asm"; then
+    echo "FAIL $name: compile error"
+    failed=1
+    continue
+  fi
+  sed -n 's|^// run: ||p' "$program" | while read -r args; do
+    python3 "$dir/mips.py" "$tmp/$name.asm" $args
+  done >"$tmp/$name.out" 2>"$tmp/$name.log"
+  # anything but the step counts is an emulator error
+  grep -v '^steps=' "$tmp/$name.log" >"$tmp/$name.err"
+  if [ -s "$tmp/$name.err" ] ||
+    ! cmp -s "$tmp/$name.out" "$dir/programs/$name.expected"; then
+    echo "FAIL $name"
+    cat "$tmp/$name.err"
+    diff "$dir/programs/$name.expected" "$tmp/$name.out" | head -20
+    failed=1
+  else
+    echo "ok   $name"
+  fi
+done
+for program in "$dir"/diagnostics/*.wlp4; do
+  name=$(basename "$program" .wlp4)
+  "$compiler" "$program" 2>"$tmp/$name.diag" >/dev/null
+  echo "status $?" >>"$tmp/$name.diag"
+  if cmp -s "$tmp/$name.diag" "$dir/diagnostics/$name.expected"; then
+    echo "ok   $name"
+  else
+    echo "FAIL $name"
+    diff "$dir/diagnostics/$name.expected" "$tmp/$name.diag"
+    failed=1
+  fi
+done
+exit $failed
@@ -1,6 +1,7 @@
 #include "wlp4data.h"
+#include <stdexcept>
 
-const std::string WLP4_CFG = R"END(.CFG
+constexpr std::string_view WLP4_CFG = R"END(.CFG
 start BOF procedures EOF
 procedures procedure procedures
 procedures main
@@ -52,7 +53,7 @@ lvalue STAR factor
 lvalue LPAREN lvalue RPAREN
 )END";
 
-const std::string WLP4_TRANSITIONS = R"END(.TRANSITIONS
+constexpr std::string_view WLP4_TRANSITIONS = R"END(.TRANSITIONS
 0 BOF 45
 1 AMP 35
 1 ID 13
@@ -474,7 +475,7 @@ const std::string WLP4_TRANSITIONS = R"END(.TRANSITIONS
 99 type 48
 )END";
 
-const std::string WLP4_REDUCTIONS = R"END(.REDUCTIONS
+constexpr std::string_view WLP4_REDUCTIONS = R"END(.REDUCTIONS
 10 36 BECOMES
 10 36 COMMA
 10 36 EQ
@@ -922,5 +923,228 @@ const std::string WLP4_REDUCTIONS = R"END(.REDUCTIONS
 98 15 WHILE
 )END";
 
-const std::string WLP4_DFA = WLP4_TRANSITIONS + WLP4_REDUCTIONS;
-const std::string WLP4_COMBINED = WLP4_CFG + WLP4_DFA;
\ No newline at end of file
+
+namespace {
+
+constexpr bool isSpaceChar(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Reads whitespace separated words out of one of the text tables
+struct TableReader {
+  std::string_view text;
+  std::size_t pos = 0;
+
+  // next word, or an empty view at end of input
+  constexpr std::string_view word() {
+    while (pos < text.size() && isSpaceChar(text[pos])) {
+      ++pos;
+    }
+    std::size_t begin = pos;
+    while (pos < text.size() && !isSpaceChar(text[pos])) {
+      ++pos;
+    }
+    return text.substr(begin, pos - begin);
+  }
+
+  // true if only blanks remain on the current line
+  constexpr bool atLineEnd() {
+    while (pos < text.size() && text[pos] != '\n' && isSpaceChar(text[pos])) {
+      ++pos;
+    }
+    return pos >= text.size() || text[pos] == '\n';
+  }
+};
+
+constexpr int parseNumber(std::string_view w) {
+  if (w.empty()) {
+    throw std::logic_error("expected a number in parse table");
+  }
+  int n = 0;
+  for (char c : w) {
+    if (c < '0' || c > '9') {
+      throw std::logic_error("expected a number in parse table");
+    }
+    n = n * 10 + (c - '0');
+  }
+  return n;
+}
+
+// Maps the spelling of a grammar symbol to its symbol id
+constexpr int symbolFromName(std::string_view name) {
+  TokenKind kind = tokenKindFromName(name);
+  if (kind != TK_NONE) {
+    return kind;
+  }
+  for (int i = TK_COUNT; i < SYMBOL_COUNT; ++i) {
+    if (NONTERMINAL_NAMES[i - TK_COUNT] == name) {
+      return i;
+    }
+  }
+  throw std::logic_error("unknown grammar symbol in parse table");
+}
+
+constexpr void setAction(ParseTable &table, int state, int symbol,
+                         ParseAction action) {
+  if (state >= WLP4_STATE_COUNT) {
+    throw std::logic_error("WLP4_STATE_COUNT is too small");
+  }
+  if (table.actions[state][symbol] != PARSE_ERROR) {
+    throw std::logic_error("conflicting entries in parse table");
+  }
+  table.actions[state][symbol] = action;
+}
+
+constexpr ParseTable buildParseTable() {
+  ParseTable table{};
+
+  // .CFG: one rule per line, "lhs rhs...", with .EMPTY for an empty rhs
+  TableReader cfg{WLP4_CFG};
+  cfg.word();
+  int rules = 0;
+  for (std::string_view lhs = cfg.word(); !lhs.empty(); lhs = cfg.word()) {
+    if (rules == WLP4_RULE_COUNT) {
+      throw std::logic_error("WLP4_RULE_COUNT is too small");
+    }
+    table.ruleLhs[rules] = symbolFromName(lhs);
+    int length = 0;
+    while (!cfg.atLineEnd()) {
+      std::string_view symbol = cfg.word();
+      if (symbol != ".EMPTY") {
+        symbolFromName(symbol);
+        ++length;
+      }
+    }
+    table.ruleLength[rules++] = length;
+  }
+  if (rules != WLP4_RULE_COUNT) {
+    throw std::logic_error("WLP4_RULE_COUNT does not match WLP4_CFG");
+  }
+
+  // .TRANSITIONS: "state symbol next", shifts on terminals and gotos on
+  // nonterminals
+  TableReader transitions{WLP4_TRANSITIONS};
+  transitions.word();
+  for (std::string_view w = transitions.word(); !w.empty();
+       w = transitions.word()) {
+    int state = parseNumber(w);
+    int symbol = symbolFromName(transitions.word());
+    int next = parseNumber(transitions.word());
+    if (next >= WLP4_STATE_COUNT) {
+      throw std::logic_error("WLP4_STATE_COUNT is too small");
+    }
+    setAction(table, state, symbol, shiftAction(next));
+  }
+
+  // .REDUCTIONS: "state rule lookahead". The .ACCEPT entry is skipped: the
+  // parser reduces by rule 0 itself once EOF has been shifted.
+  TableReader reductions{WLP4_REDUCTIONS};
+  reductions.word();
+  for (std::string_view w = reductions.word(); !w.empty();
+       w = reductions.word()) {
+    int state = parseNumber(w);
+    int rule = parseNumber(reductions.word());
+    std::string_view lookahead = reductions.word();
+    if (lookahead == ".ACCEPT") {
+      continue;
+    }
+    int symbol = symbolFromName(lookahead);
+    if (rule >= WLP4_RULE_COUNT || symbol >= TK_COUNT) {
+      throw std::logic_error("invalid reduction in parse table");
+    }
+    setAction(table, state, symbol, reduceAction(rule));
+  }
+  return table;
+}
+
+// True if the line of WLP4_CFG for rule reads exactly text; keeps the
+// Production enum in step with the grammar
+constexpr bool productionIs(Production rule, std::string_view text) {
+  TableReader cfg{WLP4_CFG};
+  cfg.word();
+  for (int i = 0; i < rule; ++i) {
+    cfg.word();
+    while (!cfg.atLineEnd()) {
+      cfg.word();
+    }
+  }
+  TableReader expected{text};
+  if (cfg.word() != expected.word()) {
+    return false;
+  }
+  while (!cfg.atLineEnd()) {
+    if (cfg.word() != expected.word()) {
+      return false;
+    }
+  }
+  return expected.word().empty();
+}
+
+static_assert(productionIs(RULE_START, "start BOF procedures EOF"));
+static_assert(productionIs(RULE_PROCEDURES_PROCEDURE,
+                           "procedures procedure procedures"));
+static_assert(productionIs(RULE_PROCEDURES_MAIN, "procedures main"));
+static_assert(productionIs(RULE_PROCEDURE,
+                           "procedure INT ID LPAREN params RPAREN LBRACE dcls "
+                           "statements RETURN expr SEMI RBRACE"));
+static_assert(productionIs(RULE_MAIN,
+                           "main INT WAIN LPAREN dcl COMMA dcl RPAREN LBRACE "
+                           "dcls statements RETURN expr SEMI RBRACE"));
+static_assert(productionIs(RULE_PARAMS_EMPTY, "params .EMPTY"));
+static_assert(productionIs(RULE_PARAMS, "params paramlist"));
+static_assert(productionIs(RULE_PARAMLIST, "paramlist dcl"));
+static_assert(productionIs(RULE_PARAMLIST_COMMA,
+                           "paramlist dcl COMMA paramlist"));
+static_assert(productionIs(RULE_TYPE_INT, "type INT"));
+static_assert(productionIs(RULE_TYPE_INT_STAR, "type INT STAR"));
+static_assert(productionIs(RULE_DCLS_EMPTY, "dcls .EMPTY"));
+static_assert(productionIs(RULE_DCLS_NUM, "dcls dcls dcl BECOMES NUM SEMI"));
+static_assert(productionIs(RULE_DCLS_NULL, "dcls dcls dcl BECOMES NULL SEMI"));
+static_assert(productionIs(RULE_DCL, "dcl type ID"));
+static_assert(productionIs(RULE_STATEMENTS_EMPTY, "statements .EMPTY"));
+static_assert(productionIs(RULE_STATEMENTS, "statements statements statement"));
+static_assert(productionIs(RULE_STATEMENT_ASSIGN,
+                           "statement lvalue BECOMES expr SEMI"));
+static_assert(productionIs(RULE_STATEMENT_IF,
+                           "statement IF LPAREN test RPAREN LBRACE statements "
+                           "RBRACE ELSE LBRACE statements RBRACE"));
+static_assert(productionIs(RULE_STATEMENT_WHILE,
+                           "statement WHILE LPAREN test RPAREN LBRACE "
+                           "statements RBRACE"));
+static_assert(productionIs(RULE_STATEMENT_PRINTLN,
+                           "statement PRINTLN LPAREN expr RPAREN SEMI"));
+static_assert(productionIs(RULE_STATEMENT_DELETE,
+                           "statement DELETE LBRACK RBRACK expr SEMI"));
+static_assert(productionIs(RULE_TEST_EQ, "test expr EQ expr"));
+static_assert(productionIs(RULE_TEST_NE, "test expr NE expr"));
+static_assert(productionIs(RULE_TEST_LT, "test expr LT expr"));
+static_assert(productionIs(RULE_TEST_LE, "test expr LE expr"));
+static_assert(productionIs(RULE_TEST_GE, "test expr GE expr"));
+static_assert(productionIs(RULE_TEST_GT, "test expr GT expr"));
+static_assert(productionIs(RULE_EXPR_TERM, "expr term"));
+static_assert(productionIs(RULE_EXPR_PLUS, "expr expr PLUS term"));
+static_assert(productionIs(RULE_EXPR_MINUS, "expr expr MINUS term"));
+static_assert(productionIs(RULE_TERM_FACTOR, "term factor"));
+static_assert(productionIs(RULE_TERM_STAR, "term term STAR factor"));
+static_assert(productionIs(RULE_TERM_SLASH, "term term SLASH factor"));
+static_assert(productionIs(RULE_TERM_PCT, "term term PCT factor"));
+static_assert(productionIs(RULE_FACTOR_ID, "factor ID"));
+static_assert(productionIs(RULE_FACTOR_NUM, "factor NUM"));
+static_assert(productionIs(RULE_FACTOR_NULL, "factor NULL"));
+static_assert(productionIs(RULE_FACTOR_PAREN, "factor LPAREN expr RPAREN"));
+static_assert(productionIs(RULE_FACTOR_AMP, "factor AMP lvalue"));
+static_assert(productionIs(RULE_FACTOR_STAR, "factor STAR factor"));
+static_assert(productionIs(RULE_FACTOR_NEW,
+                           "factor NEW INT LBRACK expr RBRACK"));
+static_assert(productionIs(RULE_FACTOR_CALL, "factor ID LPAREN RPAREN"));
+static_assert(productionIs(RULE_FACTOR_CALL_ARGS,
+                           "factor ID LPAREN arglist RPAREN"));
+static_assert(productionIs(RULE_ARGLIST, "arglist expr"));
+static_assert(productionIs(RULE_ARGLIST_COMMA, "arglist expr COMMA arglist"));
+static_assert(productionIs(RULE_LVALUE_ID, "lvalue ID"));
+static_assert(productionIs(RULE_LVALUE_STAR, "lvalue STAR factor"));
+static_assert(productionIs(RULE_LVALUE_PAREN, "lvalue LPAREN lvalue RPAREN"));
+
+} // namespace
+
+constexpr ParseTable WLP4_PARSE_TABLE = buildParseTable();
@@ -1,21 +1,137 @@
 #ifndef WLP4DATA_H
 #define WLP4DATA_H
 
-#include <string>
+#include "structures.h"
+#include <cstdint>
+#include <string_view>
 
 // Context-free grammar rules for WLP4
-extern const std::string WLP4_CFG;
+extern const std::string_view WLP4_CFG;
 
 // DFA state transition table
-extern const std::string WLP4_TRANSITIONS;
+extern const std::string_view WLP4_TRANSITIONS;
 
 // Reduction rules for parser
-extern const std::string WLP4_REDUCTIONS;
+extern const std::string_view WLP4_REDUCTIONS;
 
-// Complete DFA specification
-extern const std::string WLP4_DFA;
+// Nonterminals of the WLP4 grammar. Grammar symbols are numbered with the
+// terminals first (as their TokenKind) and the nonterminals after them.
+enum Nonterminal : std::uint8_t {
+  NT_START = TK_COUNT,
+  NT_PROCEDURES,
+  NT_PROCEDURE,
+  NT_MAIN,
+  NT_PARAMS,
+  NT_PARAMLIST,
+  NT_TYPE,
+  NT_DCLS,
+  NT_DCL,
+  NT_STATEMENTS,
+  NT_STATEMENT,
+  NT_TEST,
+  NT_EXPR,
+  NT_TERM,
+  NT_FACTOR,
+  NT_ARGLIST,
+  NT_LVALUE,
+  SYMBOL_COUNT
+};
 
-// Combined grammar and DFA data
-extern const std::string WLP4_COMBINED;
+constexpr std::string_view NONTERMINAL_NAMES[SYMBOL_COUNT - TK_COUNT] = {
+    "start",      "procedures", "procedure", "main",   "params", "paramlist",
+    "type",       "dcls",       "dcl",       "statements", "statement",
+    "test",       "expr",       "term",      "factor", "arglist", "lvalue"};
 
-#endif
\ No newline at end of file
+// Grammar spelling of a symbol id
+constexpr std::string_view symbolName(int symbol) {
+  return symbol < TK_COUNT ? TOKEN_KIND_NAMES[symbol]
+                           : NONTERMINAL_NAMES[symbol - TK_COUNT];
+}
+
+constexpr int WLP4_STATE_COUNT = 132;
+constexpr int WLP4_RULE_COUNT = 49;
+
+// Productions of WLP4_CFG, in the order they are listed there. The child
+// positions of a node follow its production's right-hand side, e.g. child(2)
+// of a RULE_STATEMENT_PRINTLN node is its expr. The numbering is checked
+// against the grammar text at compile time in wlp4data.cpp.
+enum Production : std::uint8_t {
+  RULE_START,
+  RULE_PROCEDURES_PROCEDURE,
+  RULE_PROCEDURES_MAIN,
+  RULE_PROCEDURE,
+  RULE_MAIN,
+  RULE_PARAMS_EMPTY,
+  RULE_PARAMS,
+  RULE_PARAMLIST,
+  RULE_PARAMLIST_COMMA,
+  RULE_TYPE_INT,
+  RULE_TYPE_INT_STAR,
+  RULE_DCLS_EMPTY,
+  RULE_DCLS_NUM,
+  RULE_DCLS_NULL,
+  RULE_DCL,
+  RULE_STATEMENTS_EMPTY,
+  RULE_STATEMENTS,
+  RULE_STATEMENT_ASSIGN,
+  RULE_STATEMENT_IF,
+  RULE_STATEMENT_WHILE,
+  RULE_STATEMENT_PRINTLN,
+  RULE_STATEMENT_DELETE,
+  RULE_TEST_EQ,
+  RULE_TEST_NE,
+  RULE_TEST_LT,
+  RULE_TEST_LE,
+  RULE_TEST_GE,
+  RULE_TEST_GT,
+  RULE_EXPR_TERM,
+  RULE_EXPR_PLUS,
+  RULE_EXPR_MINUS,
+  RULE_TERM_FACTOR,
+  RULE_TERM_STAR,
+  RULE_TERM_SLASH,
+  RULE_TERM_PCT,
+  RULE_FACTOR_ID,
+  RULE_FACTOR_NUM,
+  RULE_FACTOR_NULL,
+  RULE_FACTOR_PAREN,
+  RULE_FACTOR_AMP,
+  RULE_FACTOR_STAR,
+  RULE_FACTOR_NEW,
+  RULE_FACTOR_CALL,
+  RULE_FACTOR_CALL_ARGS,
+  RULE_ARGLIST,
+  RULE_ARGLIST_COMMA,
+  RULE_LVALUE_ID,
+  RULE_LVALUE_STAR,
+  RULE_LVALUE_PAREN,
+};
+
+// One entry of the SLR(1) table. 0 is a syntax error, n > 0 shifts (or for a
+// nonterminal, goes) to state n - 1 and n < 0 reduces by rule -n - 1.
+using ParseAction = std::int16_t;
+
+constexpr ParseAction PARSE_ERROR = 0;
+constexpr ParseAction shiftAction(int state) { return state + 1; }
+constexpr ParseAction reduceAction(int rule) { return -rule - 1; }
+constexpr bool isShift(ParseAction a) { return a > 0; }
+constexpr bool isReduce(ParseAction a) { return a < 0; }
+constexpr int actionState(ParseAction a) { return a - 1; }
+constexpr int actionRule(ParseAction a) { return -a - 1; }
+
+// Dense action/goto table indexed by [state][symbol], plus the left-hand
+// side and length of every rule for popping and the goto after a reduction
+struct ParseTable {
+  ParseAction actions[WLP4_STATE_COUNT][SYMBOL_COUNT];
+  std::uint8_t ruleLhs[WLP4_RULE_COUNT];
+  std::uint8_t ruleLength[WLP4_RULE_COUNT];
+
+  ParseAction action(int state, int symbol) const {
+    return actions[state][symbol];
+  }
+};
+
+// Built from the text tables above at compile time
+extern const ParseTable WLP4_PARSE_TABLE;
+
+#endif